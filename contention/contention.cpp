@@ -0,0 +1,72 @@
+#include <contention.hpp>
+
+namespace contention
+{
+
+namespace detail
+{
+
+namespace
+{
+
+std::atomic<Counters*> all_counters{};
+
+//Returns counters to other threads when thread exits, values stay in the sum
+struct Owner final
+{
+  Counters* counters{};
+
+  ~Owner()
+  {
+    if (counters)
+    {
+      counters->active.store(false, std::memory_order_release);
+    }
+  }
+};
+
+thread_local Owner owner;
+
+}
+
+Counters& countersOfCurrentThread()
+{
+  for (Counters* counters = all_counters.load(std::memory_order_acquire); counters; counters = counters->next)
+  {
+    bool expected{};
+    if (!counters->active.load(std::memory_order_relaxed) &&
+        counters->active.compare_exchange_strong(expected, true, std::memory_order_acquire))
+    {
+      owner.counters = counters;
+      return *counters;
+    }
+  }
+
+  Counters* const counters = new Counters;
+  counters->active.store(true, std::memory_order_relaxed);
+  counters->next = all_counters.load(std::memory_order_relaxed);
+  while (!all_counters.compare_exchange_weak(counters->next, counters,
+                                             std::memory_order_release,
+                                             std::memory_order_relaxed));
+
+  owner.counters = counters;
+  return *counters;
+}
+
+}
+
+Snapshot snapshot() noexcept
+{
+  std::uint64_t sums[num_of_events]{};
+  for (auto counters = detail::all_counters.load(std::memory_order_acquire); counters; counters = counters->next)
+  {
+    for (std::size_t i = 0; i < num_of_events; ++i)
+    {
+      sums[i] += counters->values[i].load(std::memory_order_relaxed);
+    }
+  }
+
+  return Snapshot{sums[0], sums[1], sums[2], sums[3]};
+}
+
+}
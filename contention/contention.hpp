@@ -0,0 +1,109 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace contention
+{
+
+enum class Event : std::size_t
+{
+  cas_attempt,
+  cas_failure,
+  //Protected pointer changed before it was published, e.g. retry in hazard_pointers::protect
+  validation_retry,
+  empty_pop,
+};
+
+constexpr std::size_t num_of_events{4};
+
+struct Snapshot final
+{
+  std::uint64_t cas_attempts{};
+  std::uint64_t cas_failures{};
+  std::uint64_t validation_retries{};
+  std::uint64_t empty_pops{};
+};
+
+//Sum of counters of all threads, including exited ones. Counters are read without stopping
+//other threads, so they may be a bit behind.
+Snapshot snapshot() noexcept;
+
+namespace detail
+{
+
+constexpr std::size_t cache_line_size{64};
+
+//Only owner thread writes its counters, so increment is plain load and store
+struct alignas(cache_line_size) Counters final
+{
+  std::atomic<std::uint64_t> values[num_of_events]{};
+  std::atomic<bool> active{};
+  Counters* next{};
+
+  void add(const Event event) noexcept
+  {
+    auto& value = values[static_cast<std::size_t>(event)];
+    value.store(value.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+  }
+};
+
+//Counters of exited threads are reused by new threads and never freed
+Counters& countersOfCurrentThread();
+
+}
+
+//Names differ, so translation units built with and without counters don't break ODR.
+//Instrumented templates take Mode as default template argument, so their instantiations
+//differ between the modes as well, e.g. Stack<int> is a different class in each of them.
+#ifdef LOCK_FREE_CONTENTION_COUNTERS
+inline namespace counting
+{
+
+struct Mode final
+{
+};
+
+constexpr bool enabled{true};
+
+inline void count(const Event event) noexcept
+{
+  static thread_local detail::Counters& counters = detail::countersOfCurrentThread();
+  counters.add(event);
+}
+
+//Wraps result of compare_exchange: while (!contention::cas(head_.compare_exchange_weak(...)));
+inline bool cas(const bool succeeded) noexcept
+{
+  count(Event::cas_attempt);
+  if (!succeeded)
+  {
+    count(Event::cas_failure);
+  }
+
+  return succeeded;
+}
+
+}
+#else
+inline namespace not_counting
+{
+
+struct Mode final
+{
+};
+
+constexpr bool enabled{false};
+
+inline void count(Event) noexcept {}
+
+inline bool cas(const bool succeeded) noexcept
+{
+  return succeeded;
+}
+
+}
+#endif
+
+}
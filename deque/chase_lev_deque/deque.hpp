@@ -0,0 +1,201 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <type_traits>
+
+#include <hp.hpp>
+
+namespace lock_free
+{
+
+//Chase-Lev work-stealing deque in C11 formulation (Le, Pop, Cohen, Zappa Nardelli). Owner pushes
+//and pops at bottom, thieves steal at top. Owner takes CAS only for the last element. Grown
+//buffer replaces the old one, which is retired, because thieves may still read from it.
+template <typename T>
+class Deque
+{
+  static_assert(std::is_trivially_copyable_v<T>, "T must be trivially copyable");
+
+  //Cells are atomic, because thief may read cell which owner overwrites, then thief's CAS fails
+  struct Buffer final : hazard_pointers::Reclaimable<Buffer>
+  {
+    const std::int64_t mask;
+    const std::unique_ptr<std::atomic<T>[]> cells;
+
+    explicit Buffer(const std::int64_t capacity)
+      : mask{capacity - 1}, cells{new std::atomic<T>[capacity]}
+    {}
+
+    std::int64_t capacity() const noexcept
+    {
+      return mask + 1;
+    }
+
+    T get(const std::int64_t index) const noexcept
+    {
+      return cells[index & mask].load(std::memory_order_relaxed);
+    }
+
+    void put(const std::int64_t index, const T value) noexcept
+    {
+      cells[index & mask].store(value, std::memory_order_relaxed);
+    }
+  };
+
+  static void destroyBuffer(Buffer* const buffer) noexcept
+  {
+    delete buffer;
+  }
+
+  static constexpr std::size_t cache_line_size{64};
+  static constexpr std::size_t default_capacity{64};
+
+  static std::int64_t roundUpToPowerOfTwo(const std::size_t capacity) noexcept
+  {
+    std::int64_t result{2};
+    for (; static_cast<std::size_t>(result) < capacity; result <<= 1);
+
+    return result;
+  }
+
+  hazard_pointers::HazardPointerDomain& domain_;
+  alignas(cache_line_size) std::atomic<std::int64_t> top_{};
+  alignas(cache_line_size) std::atomic<std::int64_t> bottom_{};
+  std::atomic<Buffer*> buffer_;
+
+ public:
+  //Capacity is rounded up to power of two, buffer grows twice when it is full
+  explicit Deque(const std::size_t capacity = default_capacity)
+    : Deque{hazard_pointers::defaultDomain(), capacity}
+  {}
+
+  explicit Deque(hazard_pointers::HazardPointerDomain& domain, const std::size_t capacity = default_capacity)
+    : domain_{domain}, buffer_{new Buffer{roundUpToPowerOfTwo(capacity)}}
+  {}
+
+  Deque(const Deque&) = delete;
+  Deque& operator=(const Deque&) = delete;
+
+  //Owner only
+  void push(const T value)
+  {
+    const std::int64_t bottom = bottom_.load(std::memory_order_relaxed);
+    const std::int64_t top = top_.load(std::memory_order_acquire);
+    Buffer* buffer = buffer_.load(std::memory_order_relaxed);
+
+    if (bottom - top > buffer->mask)
+    {
+      buffer = grow(buffer, top, bottom);
+    }
+
+    buffer->put(bottom, value);
+    std::atomic_thread_fence(std::memory_order_release);
+    bottom_.store(bottom + 1, std::memory_order_relaxed);
+  }
+
+  //Owner only, takes the last pushed element
+  std::optional<T> pop() noexcept
+  {
+    const std::int64_t bottom = bottom_.load(std::memory_order_relaxed) - 1;
+    Buffer* const buffer = buffer_.load(std::memory_order_relaxed);
+    bottom_.store(bottom, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    std::int64_t top = top_.load(std::memory_order_relaxed);
+
+    if (top > bottom)
+    {
+      bottom_.store(bottom + 1, std::memory_order_relaxed);
+      return std::nullopt;
+    }
+
+    std::optional<T> value{buffer->get(bottom)};
+    if (top == bottom)
+    {
+      //The last element, thieves compete for it
+      if (!top_.compare_exchange_strong(top, top + 1,
+                                        std::memory_order_seq_cst,
+                                        std::memory_order_relaxed))
+      {
+        value.reset();
+      }
+      bottom_.store(bottom + 1, std::memory_order_relaxed);
+    }
+
+    return value;
+  }
+
+  //Any thread, takes the first pushed element. Returns nothing when deque is empty or when
+  //another thread has taken the element first.
+  std::optional<T> steal()
+  {
+    std::int64_t top = top_.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    const std::int64_t bottom = bottom_.load(std::memory_order_acquire);
+
+    if (top >= bottom)
+    {
+      return std::nullopt;
+    }
+
+    Buffer* const buffer = hazard_pointers::protect(domain_, 0, buffer_);
+    const T value = buffer->get(top);
+    hazard_pointers::clearHazardPointers(domain_);
+
+    if (!top_.compare_exchange_strong(top, top + 1,
+                                      std::memory_order_seq_cst,
+                                      std::memory_order_relaxed))
+    {
+      return std::nullopt;
+    }
+
+    return value;
+  }
+
+  //Exact only for owner while nobody steals
+  std::size_t size() const noexcept
+  {
+    const std::int64_t bottom = bottom_.load(std::memory_order_relaxed);
+    const std::int64_t top = top_.load(std::memory_order_relaxed);
+
+    return bottom > top ? static_cast<std::size_t>(bottom - top) : 0;
+  }
+
+  bool empty() const noexcept
+  {
+    return !size();
+  }
+
+  bool is_lock_free() const noexcept
+  {
+    return top_.is_lock_free() && buffer_.is_lock_free() && std::atomic<T>{}.is_lock_free();
+  }
+
+  ~Deque()
+  {
+    delete buffer_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  //Thieves read elements of old buffer till the end of their steal, so it is retired.
+  //Owner may be a task which protects its own objects in the domain, so scan keeps its hazard pointers.
+  Buffer* grow(Buffer* const old_buffer, const std::int64_t top, const std::int64_t bottom)
+  {
+    Buffer* const buffer = new Buffer{old_buffer->capacity() * 2};
+    for (std::int64_t i = top; i < bottom; ++i)
+    {
+      buffer->put(i, old_buffer->get(i));
+    }
+
+    buffer_.store(buffer, std::memory_order_release);
+    hazard_pointers::addToReclaimList(domain_, old_buffer, &destroyBuffer);
+    hazard_pointers::scan(domain_);
+
+    return buffer;
+  }
+};
+
+}
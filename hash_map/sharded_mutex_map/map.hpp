@@ -0,0 +1,131 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+#include <utility>
+
+namespace lock_free
+{
+
+//Baseline for benchmarks: unordered_map split into shards, each under its own mutex.
+template <typename Key, typename Value, typename Hash = std::hash<Key>,
+          typename KeyEqual = std::equal_to<Key>,
+          typename Allocator = std::allocator<std::pair<const Key, Value>>>
+class HashMap
+{
+  static constexpr std::size_t cache_line_size{64};
+  static constexpr std::size_t num_of_shards{64};
+
+  struct alignas(cache_line_size) Shard final
+  {
+    std::mutex mutex;
+    std::unordered_map<Key, Value, Hash, KeyEqual, Allocator> map;
+  };
+
+  Shard shards_[num_of_shards];
+
+  Shard& shardOf(const Key& key) noexcept
+  {
+    const std::size_t hash = Hash{}(key);
+
+    return shards_[(hash ^ (hash >> std::numeric_limits<std::size_t>::digits / 2)) % num_of_shards];
+  }
+
+ public:
+  HashMap() = default;
+
+  HashMap(const HashMap&) = delete;
+  HashMap& operator=(const HashMap&) = delete;
+
+  std::optional<Value> find(const Key& key)
+  {
+    Shard& shard = shardOf(key);
+    std::lock_guard lock{shard.mutex};
+
+    const auto it = shard.map.find(key);
+    if (it == shard.map.end())
+    {
+      return std::nullopt;
+    }
+
+    return it->second;
+  }
+
+  bool contains(const Key& key)
+  {
+    Shard& shard = shardOf(key);
+    std::lock_guard lock{shard.mutex};
+
+    return shard.map.find(key) != shard.map.end();
+  }
+
+  bool insert(const Key& key, const Value& value)
+  {
+    Shard& shard = shardOf(key);
+    std::lock_guard lock{shard.mutex};
+
+    return shard.map.emplace(key, value).second;
+  }
+
+  bool insert(const Key& key, Value&& value)
+  {
+    Shard& shard = shardOf(key);
+    std::lock_guard lock{shard.mutex};
+
+    return shard.map.emplace(key, std::move(value)).second;
+  }
+
+  bool insert_or_assign(const Key& key, const Value& value)
+  {
+    Shard& shard = shardOf(key);
+    std::lock_guard lock{shard.mutex};
+
+    return shard.map.insert_or_assign(key, value).second;
+  }
+
+  bool insert_or_assign(const Key& key, Value&& value)
+  {
+    Shard& shard = shardOf(key);
+    std::lock_guard lock{shard.mutex};
+
+    return shard.map.insert_or_assign(key, std::move(value)).second;
+  }
+
+  bool erase(const Key& key)
+  {
+    Shard& shard = shardOf(key);
+    std::lock_guard lock{shard.mutex};
+
+    return shard.map.erase(key);
+  }
+
+  //Shards are locked one by one, so result is exact only without concurrent modifications
+  std::size_t size()
+  {
+    std::size_t result{};
+    for (auto& shard : shards_)
+    {
+      std::lock_guard lock{shard.mutex};
+      result += shard.map.size();
+    }
+
+    return result;
+  }
+
+  bool empty()
+  {
+    return !size();
+  }
+
+  bool is_lock_free() const noexcept
+  {
+    return false;
+  }
+};
+
+}
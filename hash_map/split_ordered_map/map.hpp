@@ -0,0 +1,647 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <new>
+#include <optional>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+#include <hp.hpp>
+
+namespace lock_free
+{
+
+//Split-ordered list (Shalev, Shavit). All elements live in one sorted list ordered by bit-reversed
+//hash, bucket is a shortcut to dummy node inside of the list. Doubling of bucket count only
+//splits buckets logically, new buckets are initialized lazily from their parents, so elements
+//are never moved. List itself is Harris-Michael list with hazard pointers.
+template <typename Key, typename Value, typename Hash = std::hash<Key>,
+          typename KeyEqual = std::equal_to<Key>,
+          typename Allocator = std::allocator<std::pair<const Key, Value>>>
+class HashMap
+{
+  static_assert(std::is_nothrow_destructible_v<Key>, "destructor of Key must not throw");
+  static_assert(std::is_nothrow_destructible_v<Value>, "destructor of Value must not throw");
+
+  //Value is boxed, so insert_or_assign replaces it with one CAS. Marked pointer to box means
+  //that element is erased, it is the point where erase takes effect.
+  struct ValueBox final : hazard_pointers::Reclaimable<ValueBox>
+  {
+    Value value;
+
+    template <typename... Args>
+    explicit ValueBox(Args&&... args) : value(std::forward<Args>(args)...) {}
+  };
+
+  //Dummy node has even split-order key and no key and value
+  struct Node final : hazard_pointers::Reclaimable<Node>
+  {
+    const std::size_t so_key;
+    std::atomic<Node*> next{};
+    std::atomic<ValueBox*> box{};
+    alignas(Key) std::byte storage[sizeof(Key)];
+
+    explicit Node(const std::size_t so_key) noexcept : so_key{so_key} {}
+
+    Node(const std::size_t so_key, const Key& key, ValueBox* const box) : so_key{so_key}, box{box}
+    {
+      ::new (static_cast<void*>(storage)) Key(key);
+    }
+
+    bool isDummy() const noexcept
+    {
+      return !(so_key & 1);
+    }
+
+    const Key& key() const noexcept
+    {
+      return *std::launder(reinterpret_cast<const Key*>(storage));
+    }
+
+    ~Node()
+    {
+      if (!isDummy())
+      {
+        key().~Key();
+      }
+    }
+  };
+
+  using NodeAllocator = typename std::allocator_traits<Allocator>::template rebind_alloc<Node>;
+  using NodeAllocatorTraits = std::allocator_traits<NodeAllocator>;
+  using BoxAllocator = typename std::allocator_traits<Allocator>::template rebind_alloc<ValueBox>;
+  using BoxAllocatorTraits = std::allocator_traits<BoxAllocator>;
+
+  static_assert(NodeAllocatorTraits::is_always_equal::value, "node allocator must be stateless");
+  static_assert(BoxAllocatorTraits::is_always_equal::value, "value allocator must be stateless");
+
+  template <typename Traits, typename... Args>
+  static auto* create(Args&&... args)
+  {
+    typename Traits::allocator_type allocator;
+    auto* const object = Traits::allocate(allocator, 1);
+    try
+    {
+      Traits::construct(allocator, object, std::forward<Args>(args)...);
+    }
+    catch (...)
+    {
+      Traits::deallocate(allocator, object, 1);
+      throw;
+    }
+
+    return object;
+  }
+
+  template <typename Traits>
+  static void destroy(typename Traits::value_type* const object) noexcept
+  {
+    typename Traits::allocator_type allocator;
+    Traits::destroy(allocator, object);
+    Traits::deallocate(allocator, object, 1);
+  }
+
+  static void destroyBox(ValueBox* const box) noexcept
+  {
+    destroy<BoxAllocatorTraits>(box);
+  }
+
+  //Box of node is replaced only through retirement, so the last one belongs to the node
+  static void destroyNode(Node* const node) noexcept
+  {
+    if (!node->isDummy())
+    {
+      destroyBox(unmarked(node->box.load(std::memory_order_relaxed)));
+    }
+    destroy<NodeAllocatorTraits>(node);
+  }
+
+  template <typename P>
+  static bool isMarked(P* const p) noexcept
+  {
+    return reinterpret_cast<std::uintptr_t>(p) & 1;
+  }
+
+  template <typename P>
+  static P* marked(P* const p) noexcept
+  {
+    return reinterpret_cast<P*>(reinterpret_cast<std::uintptr_t>(p) | 1);
+  }
+
+  template <typename P>
+  static P* unmarked(P* const p) noexcept
+  {
+    return reinterpret_cast<P*>(reinterpret_cast<std::uintptr_t>(p) & ~std::uintptr_t{1});
+  }
+
+  static constexpr std::size_t digits{std::numeric_limits<std::size_t>::digits};
+
+  static std::size_t reverseBits(std::size_t value) noexcept
+  {
+    std::size_t result{};
+    for (std::size_t i = 0; i < digits; ++i, value >>= 1)
+    {
+      result = (result << 1) | (value & 1);
+    }
+
+    return result;
+  }
+
+  //Highest bit of hash is dropped, so regular key is odd and follows dummy of its bucket
+  static std::size_t regularKey(const std::size_t hash) noexcept
+  {
+    return reverseBits(hash | (std::size_t{1} << (digits - 1)));
+  }
+
+  static std::size_t dummyKey(const std::size_t bucket) noexcept
+  {
+    return reverseBits(bucket);
+  }
+
+  static std::size_t highestBit(const std::size_t value) noexcept
+  {
+    std::size_t bit{};
+    for (; value >> (bit + 1); ++bit);
+
+    return bit;
+  }
+
+  //Segment s > 0 keeps buckets [2^s, 2^(s+1)), segment 0 keeps buckets 0 and 1
+  static constexpr std::size_t max_segments{digits - 1};
+  static constexpr std::size_t max_bucket_count{std::size_t{1} << max_segments};
+  static constexpr std::size_t initial_bucket_count{16};
+  //Average number of elements per bucket after which bucket count is doubled
+  static constexpr std::size_t max_load{2};
+
+  static constexpr std::size_t cache_line_size{64};
+
+  using Bucket = std::atomic<Node*>;
+
+  hazard_pointers::HazardPointerDomain& domain_;
+  std::atomic<Bucket*> segments_[max_segments]{};
+  alignas(cache_line_size) std::atomic<std::size_t> bucket_count_{initial_bucket_count};
+  alignas(cache_line_size) std::atomic<std::size_t> size_{};
+
+ public:
+  HashMap() : HashMap{hazard_pointers::defaultDomain()} {}
+
+  //Walk through the list needs two hazard pointers and reading of value needs one more
+  explicit HashMap(hazard_pointers::HazardPointerDomain& domain) : domain_{domain}
+  {
+    if (domain_.slotsPerThread() < 3)
+    {
+      throw std::invalid_argument{"hash map needs three hazard pointers per thread"};
+    }
+
+    Node* const head = create<NodeAllocatorTraits>(dummyKey(0));
+    try
+    {
+      bucket(0).store(head, std::memory_order_relaxed);
+    }
+    catch (...)
+    {
+      destroyNode(head);
+      throw;
+    }
+  }
+
+  HashMap(const HashMap&) = delete;
+  HashMap& operator=(const HashMap&) = delete;
+
+  //Returns copy of value, because element may be erased right after return
+  std::optional<Value> find(const Key& key)
+  {
+    const Position position = search(key);
+    if (!position.found)
+    {
+      hazard_pointers::clearHazardPointers(domain_);
+      return std::nullopt;
+    }
+
+    ValueBox* box = position.curr->box.load();
+    for (;;)
+    {
+      if (isMarked(box))
+      {
+        hazard_pointers::clearHazardPointers(domain_);
+        return std::nullopt;
+      }
+
+      hazard_pointers::publish(domain_, value_slot, box);
+      ValueBox* const again = position.curr->box.load();
+      if (again == box)
+      {
+        break;
+      }
+      box = again;
+    }
+
+    try
+    {
+      std::optional<Value> value{box->value};
+      hazard_pointers::clearHazardPointers(domain_);
+
+      return value;
+    }
+    catch (...)
+    {
+      hazard_pointers::clearHazardPointers(domain_);
+      throw;
+    }
+  }
+
+  bool contains(const Key& key)
+  {
+    const Position position = search(key);
+    const bool found = position.found && !isMarked(position.curr->box.load());
+    hazard_pointers::clearHazardPointers(domain_);
+
+    return found;
+  }
+
+  //Returns false and leaves map untouched when key is already there
+  bool insert(const Key& key, const Value& value)
+  {
+    return insertData(key, value);
+  }
+
+  bool insert(const Key& key, Value&& value)
+  {
+    return insertData(key, std::move(value));
+  }
+
+  //Returns true if element was inserted and false if value was assigned
+  bool insert_or_assign(const Key& key, const Value& value)
+  {
+    return insertOrAssignData(key, value);
+  }
+
+  bool insert_or_assign(const Key& key, Value&& value)
+  {
+    return insertOrAssignData(key, std::move(value));
+  }
+
+  bool erase(const Key& key)
+  {
+    for (;;)
+    {
+      const Position position = search(key);
+      if (!position.found)
+      {
+        hazard_pointers::clearHazardPointers(domain_);
+        return false;
+      }
+
+      Node* const node = position.curr;
+      ValueBox* box = node->box.load();
+      if (isMarked(box))
+      {
+        continue;
+      }
+
+      if (node->box.compare_exchange_strong(box, marked(box)))
+      {
+        size_.fetch_sub(1, std::memory_order_relaxed);
+
+        //Node is unlinked by this search or by some other thread on its way
+        markNext(node);
+        search(key);
+        hazard_pointers::reclaimIfPossible(domain_);
+
+        return true;
+      }
+    }
+  }
+
+  //Exact only when map is not modified concurrently
+  std::size_t size() const noexcept
+  {
+    return size_.load(std::memory_order_relaxed);
+  }
+
+  bool empty() const noexcept
+  {
+    return !size();
+  }
+
+  std::size_t bucket_count() const noexcept
+  {
+    return bucket_count_.load(std::memory_order_relaxed);
+  }
+
+  bool is_lock_free() const noexcept
+  {
+    return segments_[0].is_lock_free() && size_.is_lock_free() &&
+           std::atomic<Node*>{}.is_lock_free();
+  }
+
+  ~HashMap()
+  {
+    for (Node* node = segments_[0].load(std::memory_order_acquire)[0].load(std::memory_order_relaxed); node;)
+    {
+      Node* const next = unmarked(node->next.load(std::memory_order_relaxed));
+      destroyNode(node);
+      node = next;
+    }
+
+    for (auto& segment : segments_)
+    {
+      delete[] segment.load(std::memory_order_relaxed);
+    }
+  }
+
+ private:
+  //Slots 0 and 1 are taken by prev and curr in turn
+  static constexpr std::size_t value_slot{2};
+
+  struct Position
+  {
+    Node* prev;
+    Node* curr;
+    bool found;
+  };
+
+  Bucket& bucket(const std::size_t index)
+  {
+    const std::size_t segment_index = index < 2 ? 0 : highestBit(index);
+    const std::size_t segment_size = index < 2 ? 2 : std::size_t{1} << segment_index;
+
+    std::atomic<Bucket*>& segment = segments_[segment_index];
+    Bucket* buckets = segment.load(std::memory_order_acquire);
+    if (!buckets)
+    {
+      Bucket* const allocated = new Bucket[segment_size]{};
+      if (segment.compare_exchange_strong(buckets, allocated,
+                                          std::memory_order_acq_rel,
+                                          std::memory_order_acquire))
+      {
+        buckets = allocated;
+      }
+      else
+      {
+        delete[] allocated;
+      }
+    }
+
+    return buckets[index < 2 ? index : index - segment_size];
+  }
+
+  //Parent of bucket is the bucket it was split from, so its dummy precedes dummy of child
+  Node* bucketHead(const std::size_t index)
+  {
+    Bucket& slot = bucket(index);
+    if (Node* const head = slot.load(std::memory_order_acquire))
+    {
+      return head;
+    }
+
+    const std::size_t parent = index & ~(std::size_t{1} << highestBit(index));
+    Node* const parent_head = bucketHead(parent);
+
+    Node* const dummy = create<NodeAllocatorTraits>(dummyKey(index));
+    Node* head{};
+    for (;;)
+    {
+      const Position position = search(parent_head, dummy->so_key, nullptr);
+      if (position.found)
+      {
+        destroyNode(dummy);
+        head = position.curr;
+        break;
+      }
+
+      dummy->next.store(position.curr, std::memory_order_relaxed);
+      Node* expected = position.curr;
+      if (position.prev->next.compare_exchange_strong(expected, dummy))
+      {
+        head = dummy;
+        break;
+      }
+    }
+    hazard_pointers::clearHazardPointers(domain_);
+
+    //Dummies are never removed, so every thread stores the same node
+    slot.store(head, std::memory_order_release);
+
+    return head;
+  }
+
+  Position search(const Key& key)
+  {
+    const std::size_t hash = Hash{}(key);
+    Node* const head = bucketHead(hash & (bucket_count_.load(std::memory_order_relaxed) - 1));
+
+    return search(head, regularKey(hash), &key);
+  }
+
+  //Finds the first node which is not less than so_key and key, unlinks erased nodes on the way.
+  //Key is null while dummy is searched. Head is dummy, so it needs no hazard pointer.
+  Position search(Node* const head, const std::size_t so_key, const Key* const key) noexcept
+  {
+    Position position;
+    while (!tryToSearch(head, so_key, key, position));
+
+    return position;
+  }
+
+  //Fails when prev is changed under the walk, then it starts from head again
+  bool tryToSearch(Node* const head, const std::size_t so_key, const Key* const key,
+                   Position& position) noexcept
+  {
+    std::size_t prev_slot{1};
+    std::size_t curr_slot{0};
+    Node* prev = head;
+    Node* curr = prev->next.load(std::memory_order_acquire);
+
+    for (;;)
+    {
+      if (!curr)
+      {
+        position = Position{prev, nullptr, false};
+        return true;
+      }
+
+      hazard_pointers::publish(domain_, curr_slot, curr);
+      if (prev->next.load() != curr)
+      {
+        return false;
+      }
+
+      Node* const next = curr->next.load(std::memory_order_acquire);
+      if (isMarked(next))
+      {
+        Node* expected = curr;
+        if (!prev->next.compare_exchange_strong(expected, unmarked(next)))
+        {
+          return false;
+        }
+
+        hazard_pointers::addToReclaimList(domain_, curr, &destroyNode);
+        curr = unmarked(next);
+        continue;
+      }
+
+      //Element is erased but isn't marked for unlinking yet
+      if (!curr->isDummy() && isMarked(curr->box.load()))
+      {
+        markNext(curr);
+        continue;
+      }
+
+      if (curr->so_key > so_key)
+      {
+        position = Position{prev, curr, false};
+        return true;
+      }
+
+      if (curr->so_key == so_key && (!key || KeyEqual{}(curr->key(), *key)))
+      {
+        position = Position{prev, curr, true};
+        return true;
+      }
+
+      prev = curr;
+      std::swap(prev_slot, curr_slot);
+      curr = next;
+    }
+  }
+
+  static void markNext(Node* const node) noexcept
+  {
+    Node* next = node->next.load(std::memory_order_relaxed);
+    while (!isMarked(next) && !node->next.compare_exchange_weak(next, marked(next)));
+  }
+
+  //Node is created once and reused if somebody inserts in front of it
+  template <typename V>
+  bool insertData(const Key& key, V&& value)
+  {
+    Node* node{};
+    for (;;)
+    {
+      const Position position = search(key);
+      if (position.found)
+      {
+        hazard_pointers::clearHazardPointers(domain_);
+        if (node)
+        {
+          destroyNode(node);
+        }
+        return false;
+      }
+
+      if (!node)
+      {
+        try
+        {
+          node = createRegular(key, std::forward<V>(value));
+        }
+        catch (...)
+        {
+          hazard_pointers::clearHazardPointers(domain_);
+          throw;
+        }
+      }
+
+      if (linkNode(position, node))
+      {
+        return true;
+      }
+    }
+  }
+
+  template <typename V>
+  bool insertOrAssignData(const Key& key, V&& value)
+  {
+    ValueBox* const box = create<BoxAllocatorTraits>(std::forward<V>(value));
+    Node* node{};
+    for (;;)
+    {
+      const Position position = search(key);
+      if (!position.found)
+      {
+        if (!node)
+        {
+          try
+          {
+            node = create<NodeAllocatorTraits>(regularKey(Hash{}(key)), key, box);
+          }
+          catch (...)
+          {
+            hazard_pointers::clearHazardPointers(domain_);
+            destroyBox(box);
+            throw;
+          }
+        }
+
+        if (linkNode(position, node))
+        {
+          return true;
+        }
+        continue;
+      }
+
+      //Erased element is absent, so next search goes the insert way
+      ValueBox* old_box = position.curr->box.load();
+      if (!isMarked(old_box) && position.curr->box.compare_exchange_strong(old_box, box))
+      {
+        if (node)
+        {
+          //Node owns the box, so it is released before destruction
+          node->box.store(nullptr, std::memory_order_relaxed);
+          destroy<NodeAllocatorTraits>(node);
+        }
+
+        hazard_pointers::addToReclaimList(domain_, old_box, &destroyBox);
+        hazard_pointers::reclaimIfPossible(domain_);
+
+        return false;
+      }
+    }
+  }
+
+  template <typename V>
+  Node* createRegular(const Key& key, V&& value)
+  {
+    ValueBox* const box = create<BoxAllocatorTraits>(std::forward<V>(value));
+    try
+    {
+      return create<NodeAllocatorTraits>(regularKey(Hash{}(key)), key, box);
+    }
+    catch (...)
+    {
+      destroyBox(box);
+      throw;
+    }
+  }
+
+  //Grows bucket count once load factor is exceeded, new buckets are filled on first access
+  bool linkNode(const Position& position, Node* const node) noexcept
+  {
+    node->next.store(position.curr, std::memory_order_relaxed);
+
+    Node* expected = position.curr;
+    if (!position.prev->next.compare_exchange_strong(expected, node))
+    {
+      return false;
+    }
+    hazard_pointers::clearHazardPointers(domain_);
+
+    const std::size_t size = size_.fetch_add(1, std::memory_order_relaxed) + 1;
+    std::size_t count = bucket_count_.load(std::memory_order_relaxed);
+    if (size > count * max_load && count < max_bucket_count)
+    {
+      bucket_count_.compare_exchange_strong(count, count * 2, std::memory_order_relaxed);
+    }
+
+    return true;
+  }
+};
+
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+namespace hazard_pointers::detail
+{
+
+//Tells that node lives inside of object derived from Reclaimable, so it is created together with object
+struct EmbeddedNode final
+{
+};
+
+inline constexpr EmbeddedNode embedded_node{};
+
+//Stamps of backends which need nothing but the pointer to decide whether object is reclaimed
+struct NoStamps
+{
+  NoStamps() noexcept = default;
+  explicit NoStamps(EmbeddedNode) noexcept {}
+};
+
+//Link of reclaim list. Objects derived from Reclaimable are linked directly,
+//other objects are wrapped into allocated node. Stamps keep what backend has to know about object.
+template <typename Stamps>
+class BasicNode : public Stamps
+{
+  const void* data_{};
+  void (*reclaim_)(BasicNode*) noexcept {};
+
+ public:
+  BasicNode* next{};
+
+  BasicNode() noexcept = default;
+  explicit BasicNode(const EmbeddedNode tag) noexcept : Stamps{tag} {}
+
+  void prepare(const void* const data, void (*const reclaim)(BasicNode*) noexcept) noexcept
+  {
+    data_ = data;
+    reclaim_ = reclaim;
+  }
+
+  const void* getData() const noexcept
+  {
+    return data_;
+  }
+
+  //Node must not be touched after that
+  void reclaim() noexcept
+  {
+    reclaim_(this);
+  }
+};
+
+}
@@ -0,0 +1,143 @@
+#pragma once
+
+#include <new>
+#include <type_traits>
+
+//Retirement part of the interface which is the same for every backend. Backend declares
+//detail::Node and detail::retire before this header and implements detail::onRetireFailure.
+//detail::retire puts node into reclaim list and may throw std::bad_alloc when thread can't be
+//registered in the domain.
+namespace hazard_pointers
+{
+
+class HazardPointerDomain;
+
+HazardPointerDomain& defaultDomain();
+
+namespace detail
+{
+
+template <typename T>
+class AllocatedNode final : public Node
+{
+  T* const data_;
+  void (*const deleter_)(T*);
+
+  static void reclaimNode(Node* const node) noexcept
+  {
+    const auto self = static_cast<AllocatedNode*>(node);
+    const auto data = self->data_;
+    const auto deleter = self->deleter_;
+
+    delete self;
+    deleter(data);
+  }
+
+ public:
+  AllocatedNode(T* const data, void (*const deleter)(T*)) noexcept : data_{data}, deleter_{deleter}
+  {
+    prepare(data, &reclaimNode);
+  }
+};
+
+struct ReclaimableAccess;
+
+}
+
+//Base of objects which are retired without allocation: link of reclaim list and deleter live
+//inside of retired object. T is the class derived from Reclaimable<T>.
+template <typename T>
+class Reclaimable : private detail::Node
+{
+  friend struct detail::ReclaimableAccess;
+
+  void (*deleter_)(T*){};
+
+  static void reclaimObject(detail::Node* const node) noexcept
+  {
+    const auto self = static_cast<Reclaimable*>(node);
+    self->deleter_(static_cast<T*>(self));
+  }
+
+ protected:
+  Reclaimable() noexcept : detail::Node{detail::embedded_node} {}
+  ~Reclaimable() = default;
+};
+
+namespace detail
+{
+
+struct ReclaimableAccess
+{
+  template <typename T>
+  static Node* prepare(T* const object, void (*const deleter)(T*)) noexcept
+  {
+    Reclaimable<T>* const reclaimable = object;
+    reclaimable->deleter_ = deleter;
+
+    Node* const node = reclaimable;
+    node->prepare(object, &Reclaimable<T>::reclaimObject);
+
+    return node;
+  }
+};
+
+template <typename T>
+constexpr bool is_reclaimable_v = std::is_base_of_v<Reclaimable<T>, T>;
+
+template <typename T>
+void deleteObject(T* const data) noexcept
+{
+  delete data;
+}
+
+//Called when node or registration can't be allocated, frees what backend can and returns true
+//when nobody points to data anymore, so it is deleted at once
+bool onRetireFailure(HazardPointerDomain& domain, const void* data) noexcept;
+
+}
+
+//Deleter is called when nobody points to data, e.g. to return memory to a pool
+//Objects derived from Reclaimable are retired without allocation
+template <typename T>
+void addToReclaimList(HazardPointerDomain& domain, T* const data, void (*const deleter)(T*)) noexcept
+{
+  for (;;)
+  {
+    try
+    {
+      if constexpr (detail::is_reclaimable_v<T>)
+      {
+        detail::retire(domain, detail::ReclaimableAccess::prepare(data, deleter));
+      }
+      else
+      {
+        detail::retire(domain, new detail::AllocatedNode<T>{data, deleter});
+      }
+      break;
+    }
+    catch (const std::bad_alloc&)
+    {
+      if (detail::onRetireFailure(domain, data))
+      {
+        deleter(data);
+        break;
+      }
+    }
+  }
+}
+
+template <typename T>
+void addToReclaimList(T* const data, void (*const deleter)(T*)) noexcept
+{
+  addToReclaimList(defaultDomain(), data, deleter);
+}
+
+template <typename T>
+void addToReclaimList(const T* const data) noexcept
+{
+  static_assert(std::is_nothrow_destructible_v<T>, "destructor of T must not throw");
+  addToReclaimList(data, &detail::deleteObject<const T>);
+}
+
+}
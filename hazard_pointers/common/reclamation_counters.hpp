@@ -0,0 +1,62 @@
+#pragma once
+
+#include <reclamation_stats.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+namespace hazard_pointers::detail
+{
+
+constexpr std::size_t cache_line_size{64};
+
+//Counters for reclamationStats on their own cache line
+struct alignas(cache_line_size) ReclamationCounters
+{
+  //Retired objects in lists shared by threads
+  std::atomic<std::size_t> shared_retired{};
+  std::atomic<std::size_t> peak_retired{};
+  std::atomic<std::uint64_t> scans{};
+  std::atomic<std::uint64_t> reclaimed{};
+  std::atomic<std::uint64_t> scan_nanoseconds{};
+  std::atomic<std::uint64_t> max_scan_nanoseconds{};
+  std::atomic<std::uint64_t> handed_off{};
+
+  void updatePeak(const std::size_t retired) noexcept
+  {
+    for (std::size_t peak = peak_retired.load(std::memory_order_relaxed);
+         peak < retired && !peak_retired.compare_exchange_weak(peak, retired, std::memory_order_relaxed););
+  }
+
+  void addScan(const std::uint64_t reclaimed_by_scan, const std::chrono::steady_clock::time_point begin) noexcept
+  {
+    const std::uint64_t elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                    std::chrono::steady_clock::now() - begin).count();
+
+    scans.fetch_add(1, std::memory_order_relaxed);
+    reclaimed.fetch_add(reclaimed_by_scan, std::memory_order_relaxed);
+    scan_nanoseconds.fetch_add(elapsed, std::memory_order_relaxed);
+    for (std::uint64_t max = max_scan_nanoseconds.load(std::memory_order_relaxed);
+         max < elapsed && !max_scan_nanoseconds.compare_exchange_weak(max, elapsed, std::memory_order_relaxed););
+  }
+
+  ReclamationStats get(const std::size_t retired, const std::size_t retired_by_current_thread) const noexcept
+  {
+    ReclamationStats stats;
+    stats.retired = retired;
+    stats.retired_by_current_thread = retired_by_current_thread;
+    stats.peak_retired = std::max(retired, peak_retired.load(std::memory_order_relaxed));
+    stats.scans = scans.load(std::memory_order_relaxed);
+    stats.reclaimed = reclaimed.load(std::memory_order_relaxed);
+    stats.scan_time = std::chrono::nanoseconds{scan_nanoseconds.load(std::memory_order_relaxed)};
+    stats.max_scan_time = std::chrono::nanoseconds{max_scan_nanoseconds.load(std::memory_order_relaxed)};
+    stats.handed_off = handed_off.load(std::memory_order_relaxed);
+
+    return stats;
+  }
+};
+
+}
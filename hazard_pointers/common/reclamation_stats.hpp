@@ -0,0 +1,41 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+namespace hazard_pointers
+{
+
+class HazardPointerDomain;
+
+HazardPointerDomain& defaultDomain();
+
+//Counters of reclamation in the domain, e.g. to alert when retired objects pile up. They are
+//read without stopping other threads, so values may be slightly inconsistent with each other.
+struct ReclamationStats
+{
+  //Retired objects which are not reclaimed yet, in lists of all threads
+  std::size_t retired{};
+  //Part of retired which waits in lists of current thread
+  std::size_t retired_by_current_thread{};
+  std::size_t peak_retired{};
+  std::uint64_t scans{};
+  //reclaimed / scans is the number of objects freed per scan
+  std::uint64_t reclaimed{};
+  std::chrono::nanoseconds scan_time{};
+  std::chrono::nanoseconds max_scan_time{};
+  //Objects left by exited threads to other threads of the domain
+  std::uint64_t handed_off{};
+  //Most threads registered in the domain at once, scans walk that many records
+  std::size_t records_high_water{};
+};
+
+ReclamationStats reclamationStats(const HazardPointerDomain& domain) noexcept;
+
+inline ReclamationStats reclamationStats() noexcept
+{
+  return reclamationStats(defaultDomain());
+}
+
+}
@@ -0,0 +1,171 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <memory>
+
+namespace hazard_pointers::detail
+{
+
+//Records of threads in linked blocks. Blocks are freed only with registry, so records are read
+//without protection. Registry grows with the number of threads which live at the same time:
+//record of exited thread is taken by the next registering thread.
+template <typename Record>
+class Registry final
+{
+ public:
+  static constexpr std::size_t block_size{64};
+
+ private:
+  struct Block
+  {
+    Record records[block_size]{};
+    std::atomic<Block*> next{};
+  };
+
+  Block first_;
+  //Number of records which were ever taken, scans don't look further
+  std::atomic<std::size_t> high_water_{};
+  //Records below high water mark released by threads
+  std::atomic<std::size_t> released_{};
+
+  Block* nextBlock(Block* const block)
+  {
+    Block* next = block->next.load(std::memory_order_acquire);
+    if (next)
+    {
+      return next;
+    }
+
+    auto fresh = std::make_unique<Block>();
+    if (block->next.compare_exchange_strong(next, fresh.get(), std::memory_order_acq_rel, std::memory_order_acquire))
+    {
+      return fresh.release();
+    }
+
+    return next;
+  }
+
+  Record& recordAt(const std::size_t index)
+  {
+    Block* block = &first_;
+    for (std::size_t i = index / block_size; i; --i)
+    {
+      block = nextBlock(block);
+    }
+
+    return block->records[index % block_size];
+  }
+
+  template <typename TryAcquire>
+  Record* findReleased(TryAcquire& try_acquire) noexcept
+  {
+    std::size_t remaining = high_water_.load();
+    for (Block* block = &first_; block && remaining; block = block->next.load(std::memory_order_acquire))
+    {
+      const std::size_t count = std::min(remaining, block_size);
+      for (std::size_t i = 0; i < count; ++i)
+      {
+        if (try_acquire(block->records[i]))
+        {
+          return &block->records[i];
+        }
+      }
+      remaining -= count;
+    }
+
+    return nullptr;
+  }
+
+ public:
+  Registry() = default;
+  Registry(const Registry&) = delete;
+  Registry& operator=(const Registry&) = delete;
+
+  ~Registry()
+  {
+    for (Block* block = first_.next.load(std::memory_order_relaxed); block;)
+    {
+      Block* const next = block->next.load(std::memory_order_relaxed);
+      delete block;
+      block = next;
+    }
+  }
+
+  //try_acquire takes ownership of free record and returns true, it has to load owner before CAS,
+  //so occupied records aren't written. Throws std::bad_alloc when new block can't be allocated.
+  template <typename TryAcquire>
+  Record& acquire(TryAcquire try_acquire)
+  {
+    //Released record is searched only when there is one, otherwise fresh record is taken in O(1)
+    for (std::size_t released = released_.load(std::memory_order_relaxed); released;)
+    {
+      if (!released_.compare_exchange_weak(released, released - 1, std::memory_order_relaxed))
+      {
+        continue;
+      }
+
+      if (Record* const record = findReleased(try_acquire))
+      {
+        return *record;
+      }
+
+      //Other thread took released record as a fresh one
+      released_.fetch_add(1, std::memory_order_relaxed);
+      break;
+    }
+
+    for (;;)
+    {
+      Record& record = recordAt(high_water_.fetch_add(1));
+      if (try_acquire(record))
+      {
+        return record;
+      }
+    }
+  }
+
+  //Called after owner of record is cleared
+  void release() noexcept
+  {
+    released_.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  std::size_t highWater() const noexcept
+  {
+    return high_water_.load(std::memory_order_relaxed);
+  }
+
+  //Visits every record below high water mark, stops when function returns true
+  template <typename Function>
+  bool anyOf(Function function) const noexcept
+  {
+    std::size_t remaining = high_water_.load();
+    for (const Block* block = &first_; block && remaining; block = block->next.load(std::memory_order_acquire))
+    {
+      const std::size_t count = std::min(remaining, block_size);
+      for (std::size_t i = 0; i < count; ++i)
+      {
+        if (function(block->records[i]))
+        {
+          return true;
+        }
+      }
+      remaining -= count;
+    }
+
+    return false;
+  }
+
+  template <typename Function>
+  void forEach(Function function) const noexcept
+  {
+    anyOf([&function](const Record& record) {
+      function(record);
+      return false;
+    });
+  }
+};
+
+}
@@ -0,0 +1,547 @@
+#include <hp.hpp>
+#include <reclamation_counters.hpp>
+#include <registry.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <new>
+#include <stdexcept>
+#include <vector>
+
+using hazard_pointers::detail::cache_line_size;
+//Objects retired by thread between attempts to advance global epoch
+constexpr std::size_t advance_threshold{64};
+//Object retired in epoch e is reclaimed when global epoch reaches e + 2
+constexpr std::size_t num_of_limbo_lists{3};
+constexpr std::uint64_t not_pinned{};
+
+namespace hazard_pointers
+{
+
+using Node = detail::Node;
+
+namespace
+{
+
+struct alignas(cache_line_size) EpochRecord
+{
+  std::atomic<std::thread::id> thread_id{};
+  //Epoch seen by pinned thread with lowest bit set, not_pinned otherwise
+  std::atomic<std::uint64_t> announced{};
+  //Size of limbo lists of the owner, it changes on every retire, so advancing threads don't read its line
+  alignas(cache_line_size) std::atomic<std::size_t> retired{};
+};
+
+static_assert(sizeof(EpochRecord) == 2 * cache_line_size, "announcement must take exactly one cache line");
+
+
+constexpr std::uint64_t announcement(const std::uint64_t epoch) noexcept
+{
+  return epoch << 1 | 1;
+}
+
+constexpr std::uint64_t announcedEpoch(const std::uint64_t announcement) noexcept
+{
+  return announcement >> 1;
+}
+
+std::size_t reclaimNodes(Node* head) noexcept
+{
+  std::size_t count{};
+  for (; head; ++count)
+  {
+    Node* const next = head->next;
+    head->reclaim();
+    head = next;
+  }
+
+  return count;
+}
+
+struct LimboList
+{
+  std::uint64_t epoch{};
+  Node* head{};
+  std::size_t size{};
+};
+
+//Limbo lists of exited thread, epoch is the newest one among them
+struct OrphanBatch
+{
+  std::uint64_t epoch;
+  Node* head;
+  std::size_t size;
+  OrphanBatch* next{};
+};
+
+}
+
+struct detail::DomainState
+{
+  const std::size_t slots_per_thread;
+  std::atomic<bool> domain_alive{true};
+  alignas(cache_line_size) std::atomic<std::uint64_t> global_epoch{};
+  detail::Registry<EpochRecord> records;
+  std::atomic<OrphanBatch*> orphans{};
+  ReclamationCounters counters;
+
+  explicit DomainState(const std::size_t slots_per_thread) : slots_per_thread{slots_per_thread} {}
+
+  static const std::shared_ptr<DomainState>& of(const HazardPointerDomain& domain) noexcept
+  {
+    return domain.state_;
+  }
+
+  std::size_t retired() const noexcept
+  {
+    std::size_t result = counters.shared_retired.load(std::memory_order_relaxed);
+    records.forEach([&result](const EpochRecord& record) {
+      result += record.retired.load(std::memory_order_relaxed);
+    });
+
+    return result;
+  }
+
+  void addOrphans(OrphanBatch* const first, OrphanBatch* const last) noexcept
+  {
+    last->next = orphans.load(std::memory_order_relaxed);
+
+    while (!orphans.compare_exchange_weak(last->next, first,
+                                          std::memory_order_release,
+                                          std::memory_order_relaxed));
+  }
+
+  //Reclaims orphans which are old enough, or all of them when domain is dead.
+  //Returns number of reclaimed objects.
+  std::size_t adoptOrphans(const bool all) noexcept
+  {
+    OrphanBatch* batch = orphans.exchange(nullptr, std::memory_order_acquire);
+    const std::uint64_t epoch = global_epoch.load();
+
+    std::size_t reclaimed{};
+    OrphanBatch* rest_first{};
+    OrphanBatch* rest_last{};
+    for (; batch;)
+    {
+      OrphanBatch* const next = batch->next;
+
+      if (all || batch->epoch + 2 <= epoch)
+      {
+        reclaimed += reclaimNodes(batch->head);
+        delete batch;
+      }
+      else
+      {
+        batch->next = rest_first;
+        rest_first = batch;
+        rest_last = rest_last ? rest_last : batch;
+      }
+
+      batch = next;
+    }
+
+    if (rest_first)
+    {
+      addOrphans(rest_first, rest_last);
+    }
+
+    counters.shared_retired.fetch_sub(reclaimed, std::memory_order_relaxed);
+
+    return reclaimed;
+  }
+
+  //Epoch moves only when every pinned thread has seen the current one
+  void tryAdvance() noexcept
+  {
+    std::uint64_t epoch = global_epoch.load();
+
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+
+    //Thread registered after that reads the current epoch when it pins
+    const bool lagging = records.anyOf([epoch](const EpochRecord& record) {
+      const std::uint64_t announced = record.announced.load(std::memory_order_relaxed);
+      return announced != not_pinned && announcedEpoch(announced) != epoch;
+    });
+
+    if (lagging)
+    {
+      return;
+    }
+
+    global_epoch.compare_exchange_strong(epoch, epoch + 1,
+                                         std::memory_order_release,
+                                         std::memory_order_relaxed);
+  }
+
+  //Waits until threads pinned at epoch or earlier unpin. Thread which can't register in the
+  //domain has no limbo lists, so object it retires is reclaimed after that.
+  void synchronize(const std::uint64_t epoch) noexcept
+  {
+    while (global_epoch.load() < epoch + 2)
+    {
+      tryAdvance();
+      if (global_epoch.load() < epoch + 2)
+      {
+        std::this_thread::yield();
+      }
+    }
+  }
+
+  ~DomainState()
+  {
+    adoptOrphans(true);
+  }
+};
+
+using DomainState = detail::DomainState;
+
+namespace
+{
+
+class EpochOwner final
+{
+  struct Entry
+  {
+    std::shared_ptr<DomainState> state;
+    EpochRecord* record;
+    LimboList limbo[num_of_limbo_lists]{};
+    std::size_t retired_since_advance{};
+    //Sum of sizes of limbo lists for reclamationStats
+    std::atomic<std::size_t>& published_size;
+
+    Entry(std::shared_ptr<DomainState> state, EpochRecord& record) noexcept
+      : state{std::move(state)}, record{&record}, published_size{record.retired}
+    {}
+
+    void publishSize() noexcept
+    {
+      std::size_t size{};
+      for (const auto& list : limbo)
+      {
+        size += list.size;
+      }
+
+      published_size.store(size, std::memory_order_relaxed);
+    }
+
+    std::size_t reclaimList(LimboList& list) noexcept
+    {
+      const std::size_t reclaimed = reclaimNodes(list.head);
+      list.head = nullptr;
+      list.size = 0;
+
+      return reclaimed;
+    }
+
+    //Returns number of reclaimed objects
+    std::size_t collect() noexcept
+    {
+      const std::uint64_t epoch = state->global_epoch.load();
+
+      std::size_t reclaimed{};
+      for (auto& list : limbo)
+      {
+        if (list.head && list.epoch + 2 <= epoch)
+        {
+          reclaimed += reclaimList(list);
+        }
+      }
+      publishSize();
+
+      return reclaimed;
+    }
+
+    ~Entry()
+    {
+      record->announced.store(not_pinned, std::memory_order_release);
+
+      Node* head{};
+      std::uint64_t epoch{};
+      std::size_t size{};
+      for (auto& list : limbo)
+      {
+        size += list.size;
+        for (Node* node = list.head; node;)
+        {
+          Node* const next = node->next;
+          node->next = head;
+          head = node;
+          node = next;
+        }
+
+        epoch = list.head && list.epoch > epoch ? list.epoch : epoch;
+      }
+
+      //Nobody can point to objects of dead domain. Batch which can't be allocated is leaked
+      //rather than reclaimed too early.
+      if (!state->domain_alive.load(std::memory_order_relaxed))
+      {
+        reclaimNodes(head);
+      }
+      else if (head)
+      {
+        if (auto* const batch = new (std::nothrow) OrphanBatch{epoch, head, size})
+        {
+          state->counters.handed_off.fetch_add(size, std::memory_order_relaxed);
+          state->counters.shared_retired.fetch_add(size, std::memory_order_relaxed);
+          state->addOrphans(batch, batch);
+        }
+      }
+      published_size.store(0, std::memory_order_relaxed);
+
+      record->thread_id.store(std::thread::id{}, std::memory_order_release);
+      state->records.release();
+    }
+  };
+
+  //Entry releases its record in destructor, so entries are never moved
+  std::vector<std::unique_ptr<Entry>> entries_;
+
+  static EpochRecord& acquireRecord(DomainState& state)
+  {
+    return state.records.acquire([](EpochRecord& record) {
+      std::thread::id id = record.thread_id.load(std::memory_order_relaxed);
+
+      return id == std::thread::id{} &&
+             record.thread_id.compare_exchange_strong(id, std::this_thread::get_id(), std::memory_order_relaxed);
+    });
+  }
+
+ public:
+  Entry* findEntry(const DomainState& state) const noexcept
+  {
+    for (const auto& entry : entries_)
+    {
+      if (entry->state.get() == &state)
+      {
+        return entry.get();
+      }
+    }
+    return nullptr;
+  }
+
+  Entry& getEntry(const std::shared_ptr<DomainState>& state)
+  {
+    if (Entry* const entry = findEntry(*state))
+    {
+      return *entry;
+    }
+
+    releaseDeadDomains();
+
+    entries_.reserve(entries_.size() + 1);
+    EpochRecord& record = acquireRecord(*state);
+    try
+    {
+      entries_.push_back(std::make_unique<Entry>(state, record));
+    }
+    catch (...)
+    {
+      record.thread_id.store(std::thread::id{}, std::memory_order_relaxed);
+      state->records.release();
+      throw;
+    }
+
+    return *entries_.back();
+  }
+
+  //Threads which have pinned the domain are registered already, so it fails only for thread
+  //which retires without pinning and can't allocate its entry
+  Entry* tryGetEntry(const std::shared_ptr<DomainState>& state) noexcept
+  {
+    if (Entry* const entry = findEntry(*state))
+    {
+      return entry;
+    }
+
+    try
+    {
+      return &getEntry(state);
+    }
+    catch (const std::bad_alloc&)
+    {
+      return nullptr;
+    }
+  }
+
+  void releaseDeadDomains() noexcept
+  {
+    for (auto it = entries_.begin(); it != entries_.end();)
+    {
+      if ((*it)->state->domain_alive.load(std::memory_order_relaxed))
+      {
+        ++it;
+        continue;
+      }
+
+      it = entries_.erase(it);
+    }
+  }
+};
+
+thread_local EpochOwner this_thread_epochs{};
+
+}
+
+HazardPointerDomain::HazardPointerDomain(const std::size_t slots_per_thread)
+{
+  if (!slots_per_thread || slots_per_thread > max_slots_per_thread)
+  {
+    throw std::invalid_argument{"wrong number of hazard pointers per thread"};
+  }
+
+  state_.reset(new DomainState{slots_per_thread});
+}
+
+//Data structures of the domain are gone, so nobody points to retired objects. Lists of
+//threads which are still running are reclaimed when they exit or release the domain.
+HazardPointerDomain::~HazardPointerDomain()
+{
+  state_->domain_alive.store(false, std::memory_order_relaxed);
+  state_->adoptOrphans(true);
+}
+
+std::size_t HazardPointerDomain::slotsPerThread() const noexcept
+{
+  return state_->slots_per_thread;
+}
+
+HazardPointerDomain& defaultDomain()
+{
+  static HazardPointerDomain domain{};
+
+  return domain;
+}
+
+void detail::pin(HazardPointerDomain& domain, const std::size_t slot)
+{
+  const auto& state = DomainState::of(domain);
+
+  if (slot >= state->slots_per_thread)
+  {
+    throw std::out_of_range{"no such hazard pointer slot in the domain"};
+  }
+
+  auto& record = *this_thread_epochs.getEntry(state).record;
+  if (record.announced.load(std::memory_order_relaxed) != not_pinned)
+  {
+    return;
+  }
+
+  //Stale epoch is safe: it only holds global epoch back until thread unpins
+  record.announced.store(announcement(state->global_epoch.load(std::memory_order_relaxed)),
+                         std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+}
+
+void detail::retire(HazardPointerDomain& domain, Node* const node) noexcept
+{
+  const auto& state = DomainState::of(domain);
+
+  //Object has been unlinked before, so its epoch must not be older than the unlinking
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  const std::uint64_t epoch = state->global_epoch.load(std::memory_order_relaxed);
+
+  const auto found = this_thread_epochs.tryGetEntry(state);
+  if (!found)
+  {
+    state->synchronize(epoch);
+    node->reclaim();
+    return;
+  }
+  auto& entry = *found;
+
+  //List of the same index holds objects at least three epochs older. They are counted as
+  //reclaimed, but not as a scan, as nothing is checked.
+  auto& list = entry.limbo[epoch % num_of_limbo_lists];
+  if (list.epoch != epoch)
+  {
+    if (list.head)
+    {
+      state->counters.reclaimed.fetch_add(entry.reclaimList(list), std::memory_order_relaxed);
+    }
+    list.epoch = epoch;
+  }
+
+  node->next = list.head;
+  list.head = node;
+  ++list.size;
+  entry.publishSize();
+
+  ++entry.retired_since_advance;
+}
+
+//Node is allocated after scan frees memory, retired object may still be used by pinned threads
+bool detail::onRetireFailure(HazardPointerDomain& domain, const void*) noexcept
+{
+  scan(domain);
+
+  return false;
+}
+
+void clearHazardPointers(HazardPointerDomain& domain) noexcept
+{
+  if (const auto entry = this_thread_epochs.findEntry(*DomainState::of(domain)))
+  {
+    entry->record->announced.store(not_pinned, std::memory_order_release);
+  }
+}
+
+void reclaimIfPossible(HazardPointerDomain& domain) noexcept
+{
+  const auto& state = DomainState::of(domain);
+  const auto entry = this_thread_epochs.findEntry(*state);
+
+  if (!entry)
+  {
+    return;
+  }
+
+  entry->record->announced.store(not_pinned, std::memory_order_release);
+
+  if (entry->retired_since_advance < advance_threshold)
+  {
+    return;
+  }
+
+  entry->retired_since_advance = 0;
+
+  //Backlog is the biggest right before scan, so peak is sampled here
+  const auto begin = std::chrono::steady_clock::now();
+  state->counters.updatePeak(state->retired());
+
+  state->tryAdvance();
+  const std::size_t reclaimed = entry->collect() + state->adoptOrphans(false);
+  state->counters.addScan(reclaimed, begin);
+}
+
+void scan(HazardPointerDomain& domain) noexcept
+{
+  const auto& state = DomainState::of(domain);
+
+  const auto begin = std::chrono::steady_clock::now();
+  state->counters.updatePeak(state->retired());
+
+  state->tryAdvance();
+  std::size_t reclaimed{};
+  if (const auto entry = this_thread_epochs.findEntry(*state))
+  {
+    reclaimed += entry->collect();
+  }
+  reclaimed += state->adoptOrphans(false);
+  state->counters.addScan(reclaimed, begin);
+}
+
+ReclamationStats reclamationStats(const HazardPointerDomain& domain) noexcept
+{
+  const auto& state = DomainState::of(domain);
+  const auto entry = this_thread_epochs.findEntry(*state);
+
+  auto stats = state->counters.get(state->retired(), entry ? entry->published_size.load(std::memory_order_relaxed) : 0);
+  stats.records_high_water = state->records.highWater();
+
+  return stats;
+}
+
+}
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <type_traits>
+
+#include <node.hpp>
+#include <reclamation_stats.hpp>
+
+//Epoch based reclamation with interface of hazard pointers libraries, so containers
+//choose reclamation scheme at link time. Thread pins the domain on first protect and
+//unpins it on clear, retired objects are reclaimed two global epochs later.
+namespace hazard_pointers
+{
+
+//Records are allocated on demand, so it is not thrown anymore. Kept for code which catches it.
+class NoFreeHazardPointer : public std::exception
+{
+  using exception::exception;
+};
+
+//Slots only keep interface of hazard pointers, any protect pins the whole domain
+constexpr std::size_t max_slots_per_thread{7};
+constexpr std::size_t default_slots_per_thread{3};
+
+class HazardPointerDomain;
+
+namespace detail
+{
+
+struct DomainState;
+
+using Node = BasicNode<NoStamps>;
+
+//Never allocates, as threads register in the domain when they pin it
+void retire(HazardPointerDomain& domain, Node* node) noexcept;
+
+}
+
+}
+
+#include <reclaimable.hpp>
+
+namespace hazard_pointers
+{
+
+namespace detail
+{
+
+//Enters critical section of current thread in the domain, does nothing if it is entered already
+void pin(HazardPointerDomain& domain, std::size_t slot);
+
+}
+
+class HazardPointerDomain final
+{
+ public:
+  explicit HazardPointerDomain(std::size_t slots_per_thread = default_slots_per_thread);
+  ~HazardPointerDomain();
+
+  HazardPointerDomain(const HazardPointerDomain&) = delete;
+  HazardPointerDomain& operator=(const HazardPointerDomain&) = delete;
+
+  std::size_t slotsPerThread() const noexcept;
+
+ private:
+  friend struct detail::DomainState;
+
+  //Threads keep state alive until they release their records and hand over their lists
+  std::shared_ptr<detail::DomainState> state_;
+};
+
+HazardPointerDomain& defaultDomain();
+
+//Pinned thread needs no validation, p stays valid until clearHazardPointers
+inline void publish(HazardPointerDomain& domain, const std::size_t slot, const void* const)
+{
+  detail::pin(domain, slot);
+}
+
+template <typename T>
+T* protect(HazardPointerDomain& domain, const std::size_t slot, const std::atomic<T*>& src)
+{
+  detail::pin(domain, slot);
+
+  return src.load();
+}
+
+//Reclaims objects of current thread and exited threads which are old enough,
+//current thread stays pinned
+void scan(HazardPointerDomain& domain) noexcept;
+
+//Leaves critical section of current thread in the domain
+void clearHazardPointers(HazardPointerDomain& domain) noexcept;
+
+//Unpins current thread and tries to advance global epoch once enough objects are retired
+void reclaimIfPossible(HazardPointerDomain& domain) noexcept;
+
+inline void reclaimIfPossible() noexcept
+{
+  reclaimIfPossible(defaultDomain());
+}
+
+}
@@ -0,0 +1,478 @@
+#include <hp.hpp>
+#include <reclamation_counters.hpp>
+#include <registry.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <new>
+#include <stdexcept>
+#include <vector>
+
+using hazard_pointers::detail::cache_line_size;
+constexpr std::size_t min_scan_threshold{128};
+//Objects retired by thread between ticks of era clock
+constexpr std::size_t era_frequency{32};
+
+namespace hazard_pointers
+{
+
+using Node = detail::Node;
+
+namespace
+{
+
+struct alignas(cache_line_size) EraRecord
+{
+  std::atomic<std::thread::id> thread_id{};
+  std::atomic<std::uint64_t> eras[max_slots_per_thread]{};
+  //Size of retired list of the owner, it changes on every retire, so scans don't read its line
+  alignas(cache_line_size) std::atomic<std::size_t> retired{};
+};
+
+static_assert(sizeof(EraRecord) == 2 * cache_line_size, "eras must take exactly one cache line");
+
+
+void reclaimNodes(Node* head) noexcept
+{
+  for (; head;)
+  {
+    Node* const next = head->next;
+    head->reclaim();
+    head = next;
+  }
+}
+
+}
+
+struct detail::DomainState
+{
+  const std::size_t slots_per_thread;
+  std::atomic<bool> domain_alive{true};
+  detail::Registry<EraRecord> records;
+  //Lists of exited threads wait here for other threads of the domain
+  std::atomic<Node*> orphans{};
+  ReclamationCounters counters;
+
+  explicit DomainState(const std::size_t slots_per_thread) : slots_per_thread{slots_per_thread} {}
+
+  static const std::shared_ptr<DomainState>& of(const HazardPointerDomain& domain) noexcept
+  {
+    return domain.state_;
+  }
+
+  std::size_t retired() const noexcept
+  {
+    std::size_t result = counters.shared_retired.load(std::memory_order_relaxed);
+    records.forEach([&result](const EraRecord& record) {
+      result += record.retired.load(std::memory_order_relaxed);
+    });
+
+    return result;
+  }
+
+  void addOrphans(Node* const first, Node* const last) noexcept
+  {
+    last->next = orphans.load(std::memory_order_relaxed);
+
+    while (!orphans.compare_exchange_weak(last->next, first,
+                                          std::memory_order_release,
+                                          std::memory_order_relaxed));
+  }
+
+  ~DomainState()
+  {
+    reclaimNodes(orphans.load(std::memory_order_acquire));
+  }
+};
+
+using DomainState = detail::DomainState;
+
+namespace
+{
+
+//Whether somebody may still use object which was alive from birth till retirement
+bool reservedEraCovers(const DomainState& state, const Node& node) noexcept
+{
+  const std::uint64_t birth = node.birthEra();
+  const std::uint64_t retirement = node.retireEra();
+
+  return state.records.anyOf([&state, birth, retirement](const EraRecord& record) {
+    for (std::size_t i = 0; i < state.slots_per_thread; ++i)
+    {
+      const std::uint64_t era = record.eras[i].load();
+      if (era != detail::no_era && era >= birth && era <= retirement)
+      {
+        return true;
+      }
+    }
+
+    return false;
+  });
+}
+
+//Eras reserved at the moment of scan. Scan of R retired objects costs one pass over records
+//plus R lookups instead of R passes over records.
+class EraSnapshot final
+{
+  static constexpr std::size_t linear_search_limit{32};
+  static constexpr std::size_t inline_capacity{detail::Registry<EraRecord>::block_size * max_slots_per_thread};
+
+  std::uint64_t inline_eras_[inline_capacity];
+  std::unique_ptr<std::uint64_t[]> allocated_;
+  std::uint64_t* eras_{inline_eras_};
+  std::size_t size_{};
+  //Snapshot didn't fit into memory, so records are walked on every lookup
+  const DomainState* state_{};
+
+ public:
+  explicit EraSnapshot(const DomainState& state) noexcept
+  {
+    //Thread registered after that reserves eras newer than retirement of scanned objects
+    const std::size_t capacity = state.records.highWater() * state.slots_per_thread;
+
+    if (capacity > inline_capacity)
+    {
+      allocated_.reset(new (std::nothrow) std::uint64_t[capacity]);
+      if (!allocated_)
+      {
+        state_ = &state;
+        return;
+      }
+      eras_ = allocated_.get();
+    }
+
+    state.records.forEach([this, &state, capacity](const EraRecord& record) {
+      for (std::size_t i = 0; i < state.slots_per_thread && size_ < capacity; ++i)
+      {
+        const std::uint64_t era = record.eras[i].load();
+        if (era != detail::no_era)
+        {
+          eras_[size_++] = era;
+        }
+      }
+    });
+
+    if (size_ > linear_search_limit)
+    {
+      std::sort(eras_, eras_ + size_);
+    }
+  }
+
+  //Whether somebody may still use object which was alive from birth till retirement
+  bool covers(const Node& node) const noexcept
+  {
+    if (state_)
+    {
+      return reservedEraCovers(*state_, node);
+    }
+
+    const std::uint64_t birth = node.birthEra();
+    const std::uint64_t retirement = node.retireEra();
+
+    if (size_ > linear_search_limit)
+    {
+      const auto it = std::lower_bound(eras_, eras_ + size_, birth);
+      return it != eras_ + size_ && *it <= retirement;
+    }
+
+    //No early exit, so compiler vectorizes the loop
+    bool found{};
+    for (std::size_t i = 0; i < size_; ++i)
+    {
+      found |= (eras_[i] >= birth) & (eras_[i] <= retirement);
+    }
+
+    return found;
+  }
+};
+
+class EraOwner final
+{
+  struct Entry
+  {
+    std::shared_ptr<DomainState> state;
+    EraRecord* record;
+    Node* retired{};
+    std::size_t size{};
+    std::size_t retired_since_tick{};
+    //Objects which survived last scan, they stay pinned as long as era of a stalled reader
+    std::size_t size_after_scan{};
+    //Copy of size for reclamationStats
+    std::atomic<std::size_t>& published_size;
+
+    Entry(std::shared_ptr<DomainState> state, EraRecord& record) noexcept
+      : state{std::move(state)}, record{&record}, published_size{record.retired}
+    {}
+
+    void add(Node* const node) noexcept
+    {
+      node->next = retired;
+      retired = node;
+      published_size.store(++size, std::memory_order_relaxed);
+    }
+
+    void scan() noexcept
+    {
+      std::size_t adopted{};
+      for (Node* orphan = state->orphans.exchange(nullptr, std::memory_order_acquire); orphan; ++adopted)
+      {
+        Node* const next = orphan->next;
+        add(orphan);
+        orphan = next;
+      }
+      state->counters.shared_retired.fetch_sub(adopted, std::memory_order_relaxed);
+
+      Node* old_head = retired;
+
+      if (!old_head)
+      {
+        return;
+      }
+
+      //Backlog is the biggest right before scan, so peak is sampled here
+      const auto begin = std::chrono::steady_clock::now();
+      state->counters.updatePeak(state->retired());
+
+      const std::size_t old_size = size;
+      retired = nullptr;
+      size = 0;
+
+      const EraSnapshot snapshot{*state};
+
+      for (; old_head;)
+      {
+        Node* const next = old_head->next;
+
+        if (!snapshot.covers(*old_head))
+        {
+          old_head->reclaim();
+        }
+        else
+        {
+          add(old_head);
+        }
+
+        old_head = next;
+      }
+
+      size_after_scan = size;
+      published_size.store(size, std::memory_order_relaxed);
+      state->counters.addScan(old_size - size, begin);
+    }
+
+    ~Entry()
+    {
+      for (std::size_t i = 0; i < state->slots_per_thread; ++i)
+      {
+        record->eras[i].store(detail::no_era, std::memory_order_release);
+      }
+
+      //Nobody can point to objects of dead domain
+      if (!state->domain_alive.load(std::memory_order_relaxed))
+      {
+        reclaimNodes(retired);
+      }
+      else if (retired)
+      {
+        Node* last = retired;
+        for (; last->next; last = last->next);
+
+        state->counters.handed_off.fetch_add(size, std::memory_order_relaxed);
+        state->counters.shared_retired.fetch_add(size, std::memory_order_relaxed);
+        state->addOrphans(retired, last);
+      }
+      published_size.store(0, std::memory_order_relaxed);
+
+      record->thread_id.store(std::thread::id{}, std::memory_order_release);
+      state->records.release();
+    }
+  };
+
+  //Entry releases its record in destructor, so entries are never moved
+  std::vector<std::unique_ptr<Entry>> entries_;
+
+  static EraRecord& acquireRecord(DomainState& state)
+  {
+    return state.records.acquire([](EraRecord& record) {
+      std::thread::id id = record.thread_id.load(std::memory_order_relaxed);
+
+      return id == std::thread::id{} &&
+             record.thread_id.compare_exchange_strong(id, std::this_thread::get_id(), std::memory_order_relaxed);
+    });
+  }
+
+ public:
+  Entry* findEntry(const DomainState& state) const noexcept
+  {
+    for (const auto& entry : entries_)
+    {
+      if (entry->state.get() == &state)
+      {
+        return entry.get();
+      }
+    }
+    return nullptr;
+  }
+
+  Entry& getEntry(const std::shared_ptr<DomainState>& state)
+  {
+    if (Entry* const entry = findEntry(*state))
+    {
+      return *entry;
+    }
+
+    releaseDeadDomains();
+
+    entries_.reserve(entries_.size() + 1);
+    EraRecord& record = acquireRecord(*state);
+    try
+    {
+      entries_.push_back(std::make_unique<Entry>(state, record));
+    }
+    catch (...)
+    {
+      record.thread_id.store(std::thread::id{}, std::memory_order_relaxed);
+      state->records.release();
+      throw;
+    }
+
+    return *entries_.back();
+  }
+
+  void releaseDeadDomains() noexcept
+  {
+    for (auto it = entries_.begin(); it != entries_.end();)
+    {
+      if ((*it)->state->domain_alive.load(std::memory_order_relaxed))
+      {
+        ++it;
+        continue;
+      }
+
+      it = entries_.erase(it);
+    }
+  }
+};
+
+thread_local EraOwner this_thread_eras{};
+
+}
+
+HazardPointerDomain::HazardPointerDomain(const std::size_t slots_per_thread)
+{
+  if (!slots_per_thread || slots_per_thread > max_slots_per_thread)
+  {
+    throw std::invalid_argument{"wrong number of hazard pointers per thread"};
+  }
+
+  state_.reset(new DomainState{slots_per_thread});
+}
+
+//Data structures of the domain are gone, so nobody points to retired objects. Lists of
+//threads which are still running are reclaimed when they exit or release the domain.
+HazardPointerDomain::~HazardPointerDomain()
+{
+  state_->domain_alive.store(false, std::memory_order_relaxed);
+  reclaimNodes(state_->orphans.exchange(nullptr, std::memory_order_acquire));
+}
+
+std::size_t HazardPointerDomain::slotsPerThread() const noexcept
+{
+  return state_->slots_per_thread;
+}
+
+HazardPointerDomain& defaultDomain()
+{
+  static HazardPointerDomain domain{};
+
+  return domain;
+}
+
+std::atomic<std::uint64_t>& detail::getEraForCurrentThread(HazardPointerDomain& domain, const std::size_t slot)
+{
+  const auto& state = DomainState::of(domain);
+
+  if (slot >= state->slots_per_thread)
+  {
+    throw std::out_of_range{"no such hazard pointer slot in the domain"};
+  }
+
+  return this_thread_eras.getEntry(state).record->eras[slot];
+}
+
+void detail::retire(HazardPointerDomain& domain, Node* const node)
+{
+  auto& entry = this_thread_eras.getEntry(DomainState::of(domain));
+
+  //Object has been unlinked before, so its retirement must not be older than the unlinking
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  node->stampRetirement();
+  entry.add(node);
+
+  if (++entry.retired_since_tick >= era_frequency)
+  {
+    entry.retired_since_tick = 0;
+    era_clock.fetch_add(1);
+  }
+}
+
+//Node is allocated after scan frees memory, retired object may still be used by threads with reserved eras
+bool detail::onRetireFailure(HazardPointerDomain& domain, const void*) noexcept
+{
+  scan(domain);
+
+  return false;
+}
+
+void clearHazardPointers(HazardPointerDomain& domain) noexcept
+{
+  const auto& state = DomainState::of(domain);
+
+  if (const auto entry = this_thread_eras.findEntry(*state))
+  {
+    for (std::size_t i = 0; i < state->slots_per_thread; ++i)
+    {
+      entry->record->eras[i].store(detail::no_era, std::memory_order_release);
+    }
+  }
+}
+
+void reclaimIfPossible(HazardPointerDomain& domain) noexcept
+{
+  const auto& state = DomainState::of(domain);
+
+  if (const auto entry = this_thread_eras.findEntry(*state))
+  {
+    clearHazardPointers(domain);
+
+    //One era pins any number of objects, so list is scanned when it doubles since last scan.
+    //Then survivors of each scan are paid for by as many new objects, and retire stays O(1) amortized.
+    if (entry->size >= std::max(min_scan_threshold, 2 * entry->size_after_scan))
+    {
+      entry->scan();
+    }
+  }
+}
+
+ReclamationStats reclamationStats(const HazardPointerDomain& domain) noexcept
+{
+  const auto& state = DomainState::of(domain);
+  const auto entry = this_thread_eras.findEntry(*state);
+
+  auto stats = state->counters.get(state->retired(), entry ? entry->published_size.load(std::memory_order_relaxed) : 0);
+  stats.records_high_water = state->records.highWater();
+
+  return stats;
+}
+
+void scan(HazardPointerDomain& domain) noexcept
+{
+  const auto& state = DomainState::of(domain);
+
+  if (const auto entry = this_thread_eras.findEntry(*state))
+  {
+    entry->scan();
+  }
+}
+
+}
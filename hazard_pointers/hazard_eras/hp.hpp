@@ -0,0 +1,156 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <type_traits>
+
+#include <node.hpp>
+#include <reclamation_stats.hpp>
+
+//Hazard eras with interface of hazard pointers libraries. Slot reserves global era instead of
+//pointer, object is reclaimed when no reserved era lies between its birth and retirement, so
+//stalled thread holds back only objects which were alive in its reserved eras.
+namespace hazard_pointers
+{
+
+//Records are allocated on demand, so it is not thrown anymore. Kept for code which catches it.
+class NoFreeHazardPointer : public std::exception
+{
+  using exception::exception;
+};
+
+//Record of each thread keeps its slots on its own cache line
+constexpr std::size_t max_slots_per_thread{7};
+constexpr std::size_t default_slots_per_thread{3};
+
+class HazardPointerDomain;
+
+namespace detail
+{
+
+struct DomainState;
+
+constexpr std::uint64_t no_era{};
+
+//Shared by all domains, eras only need to grow
+inline std::atomic<std::uint64_t> era_clock{no_era + 1};
+
+//Eras of life of retired object. Birth of allocated node is unknown, so it is the oldest possible.
+//Birth of object derived from Reclaimable is stamped on construction, so object must be constructed
+//before it is published.
+class EraStamps
+{
+  std::uint64_t birth_era_{no_era};
+  std::uint64_t retire_era_{};
+
+ public:
+  EraStamps() noexcept = default;
+  explicit EraStamps(EmbeddedNode) noexcept : birth_era_{era_clock.load(std::memory_order_relaxed)} {}
+
+  void stampRetirement() noexcept
+  {
+    retire_era_ = era_clock.load();
+  }
+
+  std::uint64_t birthEra() const noexcept
+  {
+    return birth_era_;
+  }
+
+  std::uint64_t retireEra() const noexcept
+  {
+    return retire_era_;
+  }
+};
+
+using Node = BasicNode<EraStamps>;
+
+void retire(HazardPointerDomain& domain, Node* node);
+
+}
+
+}
+
+#include <reclaimable.hpp>
+
+namespace hazard_pointers
+{
+
+namespace detail
+{
+
+std::atomic<std::uint64_t>& getEraForCurrentThread(HazardPointerDomain& domain, std::size_t slot);
+
+}
+
+//Hazard eras of a domain are checked only against objects retired to the same domain,
+//so data structures with own domains don't walk records of each other
+class HazardPointerDomain final
+{
+ public:
+  explicit HazardPointerDomain(std::size_t slots_per_thread = default_slots_per_thread);
+  ~HazardPointerDomain();
+
+  HazardPointerDomain(const HazardPointerDomain&) = delete;
+  HazardPointerDomain& operator=(const HazardPointerDomain&) = delete;
+
+  std::size_t slotsPerThread() const noexcept;
+
+ private:
+  friend struct detail::DomainState;
+
+  //Threads keep state alive until they release their records and hand over their lists
+  std::shared_ptr<detail::DomainState> state_;
+};
+
+HazardPointerDomain& defaultDomain();
+
+//Reserves current era in slot, caller has to check that p is still reachable after that
+inline void publish(HazardPointerDomain& domain, const std::size_t slot, const void* const)
+{
+  detail::getEraForCurrentThread(domain, slot).store(detail::era_clock.load());
+}
+
+//Returns pointer loaded from src which stays valid until slot is changed or cleared.
+//Loop ends as soon as era doesn't change, not pointer, so it rarely repeats.
+template <typename T>
+T* protect(HazardPointerDomain& domain, const std::size_t slot, const std::atomic<T*>& src)
+{
+  std::atomic<std::uint64_t>& reserved = detail::getEraForCurrentThread(domain, slot);
+
+  std::uint64_t previous_era = reserved.load(std::memory_order_relaxed);
+  for (;;)
+  {
+    T* const p = src.load();
+
+    const std::uint64_t era = detail::era_clock.load();
+    if (era == previous_era)
+    {
+      return p;
+    }
+
+    reserved.store(era);
+    previous_era = era;
+  }
+}
+
+//Reclaims every retired object of the domain visible to current thread which is not protected,
+//eras of current thread are kept
+void scan(HazardPointerDomain& domain) noexcept;
+
+//Clears all reserved eras of current thread in the domain
+void clearHazardPointers(HazardPointerDomain& domain) noexcept;
+
+//Clears reserved eras of current thread and scans its list once it is long enough
+void reclaimIfPossible(HazardPointerDomain& domain) noexcept;
+
+inline void reclaimIfPossible() noexcept
+{
+  reclaimIfPossible(defaultDomain());
+}
+
+}
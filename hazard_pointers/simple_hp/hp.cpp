@@ -1,6 +1,15 @@
 #include <hp.hpp>
+#include <reclamation_counters.hpp>
+#include <registry.hpp>
 
-constexpr int max_nuf_of_threads{128};
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <new>
+#include <stdexcept>
+#include <vector>
+
+using hazard_pointers::detail::cache_line_size;
 
 namespace hazard_pointers
 {
@@ -8,89 +17,345 @@ namespace hazard_pointers
 namespace
 {
 
-struct HazardPointer
+struct alignas(cache_line_size) HazardRecord
 {
   std::atomic<std::thread::id> thread_id{};
-  std::atomic<void*> pointer{};
+  std::atomic<void*> pointers[max_slots_per_thread]{};
 };
 
-HazardPointer pointers[max_nuf_of_threads];
+static_assert(sizeof(HazardRecord) == cache_line_size, "record must take exactly one cache line");
 
-class HPOwner final
+}
+
+struct detail::DomainState
+{
+  const std::size_t slots_per_thread;
+  std::atomic<bool> domain_alive{true};
+  detail::Registry<HazardRecord> records;
+  ReclaimList reclaim_list;
+  ReclamationCounters counters;
+
+  explicit DomainState(const std::size_t slots_per_thread) : slots_per_thread{slots_per_thread} {}
+
+  static const std::shared_ptr<DomainState>& of(const HazardPointerDomain& domain) noexcept
+  {
+    return domain.state_;
+  }
+};
+
+using DomainState = detail::DomainState;
+
+namespace
 {
-  int index{};
+
+bool otherHazardPoints(const DomainState& state, const void* const p) noexcept
+{
+  return state.records.anyOf([&state, p](const HazardRecord& record) {
+    for (std::size_t i = 0; i < state.slots_per_thread; ++i)
+    {
+      if (p == record.pointers[i].load())
+      {
+        return true;
+      }
+    }
+
+    return false;
+  });
+}
+
+//Hazard pointers published at the moment of scan. Scan of R retired objects costs
+//one pass over records plus R lookups instead of R passes over records.
+class HazardSnapshot final
+{
+  static constexpr std::size_t linear_search_limit{32};
+  static constexpr std::size_t inline_capacity{detail::Registry<HazardRecord>::block_size * max_slots_per_thread};
+
+  std::uintptr_t inline_pointers_[inline_capacity];
+  std::unique_ptr<std::uintptr_t[]> allocated_;
+  std::uintptr_t* pointers_{inline_pointers_};
+  std::size_t size_{};
+  //Snapshot didn't fit into memory, so records are walked on every lookup
+  const DomainState* state_{};
+
  public:
-  HPOwner()
+  explicit HazardSnapshot(const DomainState& state) noexcept
   {
-    for (int i = 0; i < max_nuf_of_threads; ++i)
+    //Thread registered after that can't get pointer to object retired before scan
+    const std::size_t capacity = state.records.highWater() * state.slots_per_thread;
+
+    if (capacity > inline_capacity)
     {
-      std::thread::id id{};
-      if (pointers[i].thread_id.compare_exchange_strong(id, std::this_thread::get_id(), 
-                                                        std::memory_order_relaxed))
+      allocated_.reset(new (std::nothrow) std::uintptr_t[capacity]);
+      if (!allocated_)
       {
-        index = i;
+        state_ = &state;
         return;
       }
+      pointers_ = allocated_.get();
+    }
+
+    state.records.forEach([this, &state, capacity](const HazardRecord& record) {
+      for (std::size_t i = 0; i < state.slots_per_thread && size_ < capacity; ++i)
+      {
+        if (const void* const p = record.pointers[i].load())
+        {
+          pointers_[size_++] = reinterpret_cast<std::uintptr_t>(p);
+        }
+      }
+    });
+
+    if (size_ > linear_search_limit)
+    {
+      std::sort(pointers_, pointers_ + size_);
     }
-    throw NoFreeHazardPointer{};
   }
 
-  ~HPOwner()
+  bool contains(const void* const p) const noexcept
+  {
+    if (state_)
+    {
+      return otherHazardPoints(*state_, p);
+    }
+
+    const auto value = reinterpret_cast<std::uintptr_t>(p);
+
+    if (size_ > linear_search_limit)
+    {
+      return std::binary_search(pointers_, pointers_ + size_, value);
+    }
+
+    //No early exit, so compiler vectorizes the loop
+    bool found{};
+    for (std::size_t i = 0; i < size_; ++i)
+    {
+      found |= pointers_[i] == value;
+    }
+
+    return found;
+  }
+};
+
+class HPOwner final
+{
+  struct Entry
   {
-    pointers[index].pointer.exchange(nullptr, std::memory_order_relaxed);
-    pointers[index].thread_id.exchange(std::thread::id{}, std::memory_order_relaxed);
+    std::shared_ptr<DomainState> state;
+    HazardRecord* record;
+  };
+
+  std::vector<Entry> entries_;
+
+  static HazardRecord& acquireRecord(DomainState& state)
+  {
+    return state.records.acquire([](HazardRecord& record) {
+      std::thread::id id = record.thread_id.load(std::memory_order_relaxed);
+
+      return id == std::thread::id{} &&
+             record.thread_id.compare_exchange_strong(id, std::this_thread::get_id(), std::memory_order_relaxed);
+    });
   }
 
-  std::atomic<void*>& getPointer() const noexcept
+  static void releaseRecord(const Entry& entry) noexcept
   {
-    return pointers[index].pointer;
+    for (std::size_t i = 0; i < entry.state->slots_per_thread; ++i)
+    {
+      entry.record->pointers[i].exchange(nullptr, std::memory_order_release);
+    }
+    entry.record->thread_id.exchange(std::thread::id{}, std::memory_order_relaxed);
+    entry.state->records.release();
+  }
+
+ public:
+  HazardRecord* findRecord(const DomainState& state) const noexcept
+  {
+    for (const auto& entry : entries_)
+    {
+      if (entry.state.get() == &state)
+      {
+        return entry.record;
+      }
+    }
+    return nullptr;
+  }
+
+  HazardRecord& getRecord(const std::shared_ptr<DomainState>& state)
+  {
+    if (HazardRecord* const record = findRecord(*state))
+    {
+      return *record;
+    }
+
+    releaseDeadDomains();
+
+    entries_.reserve(entries_.size() + 1);
+    HazardRecord& record = acquireRecord(*state);
+    entries_.push_back(Entry{state, &record});
+
+    return record;
+  }
+
+  void releaseDeadDomains() noexcept
+  {
+    for (auto it = entries_.begin(); it != entries_.end();)
+    {
+      if (it->state->domain_alive.load(std::memory_order_relaxed))
+      {
+        ++it;
+        continue;
+      }
+
+      releaseRecord(*it);
+      it = entries_.erase(it);
+    }
+  }
+
+  ~HPOwner()
+  {
+    for (const auto& entry : entries_)
+    {
+      releaseRecord(entry);
+    }
   }
 };
 
+thread_local HPOwner this_thread_hp{};
+
 }
 
-std::atomic<void*>& getHazardPointerForCurrentThread()
+HazardPointerDomain::HazardPointerDomain(const std::size_t slots_per_thread)
 {
-  static thread_local const HPOwner this_thread_hp{};
+  if (!slots_per_thread || slots_per_thread > max_slots_per_thread)
+  {
+    throw std::invalid_argument{"wrong number of hazard pointers per thread"};
+  }
 
-  return this_thread_hp.getPointer();
+  state_.reset(new DomainState{slots_per_thread});
 }
 
-bool otherHazardPoints(const void* const p) noexcept
+//Data structures of the domain are gone, so nobody points to retired objects
+HazardPointerDomain::~HazardPointerDomain()
 {
-  for (int i = 0; i < max_nuf_of_threads; ++i)
+  state_->domain_alive.store(false, std::memory_order_relaxed);
+  state_->reclaim_list.reclaimAll();
+}
+
+std::size_t HazardPointerDomain::slotsPerThread() const noexcept
+{
+  return state_->slots_per_thread;
+}
+
+HazardPointerDomain& defaultDomain()
+{
+  static HazardPointerDomain domain{};
+
+  return domain;
+}
+
+std::atomic<void*>& getHazardPointerForCurrentThread(HazardPointerDomain& domain, const std::size_t slot)
+{
+  const auto& state = DomainState::of(domain);
+
+  if (slot >= state->slots_per_thread)
   {
-    if (p == pointers[i].pointer.load())
+    throw std::out_of_range{"no such hazard pointer slot in the domain"};
+  }
+
+  return this_thread_hp.getRecord(state).pointers[slot];
+}
+
+void clearHazardPointers(HazardPointerDomain& domain) noexcept
+{
+  const auto& state = DomainState::of(domain);
+
+  if (HazardRecord* const record = this_thread_hp.findRecord(*state))
+  {
+    for (std::size_t i = 0; i < state->slots_per_thread; ++i)
     {
-      return true;
+      record->pointers[i].store(nullptr, std::memory_order_release);
     }
   }
+}
 
-  return false;
+bool otherHazardPoints(const HazardPointerDomain& domain, const void* const p) noexcept
+{
+  return otherHazardPoints(*DomainState::of(domain), p);
 }
 
 using ReclaimList = detail::ReclaimList;
 
+ReclaimList& detail::getReclaimList(HazardPointerDomain& domain) noexcept
+{
+  return DomainState::of(domain)->reclaim_list;
+}
+
+void scan(HazardPointerDomain& domain) noexcept
+{
+  detail::getReclaimList(domain).reclaimIfPossible(domain);
+}
+
+//All retired objects are in one list, so counters are exact.
+//Object which nobody points to is reclaimed at once, so list holds only protected ones.
+void detail::retire(HazardPointerDomain& domain, Node* const node) noexcept
+{
+  auto& state = *DomainState::of(domain);
+
+  if (!otherHazardPoints(state, node->getData()))
+  {
+    node->reclaim();
+    return;
+  }
+
+  //Counted before it is visible to scans, so the counter doesn't go below zero
+  state.counters.updatePeak(state.counters.shared_retired.fetch_add(1, std::memory_order_relaxed) + 1);
+  state.reclaim_list.addNode(node);
+}
+
+bool detail::onRetireFailure(HazardPointerDomain& domain, const void* const data) noexcept
+{
+  return !otherHazardPoints(domain, data);
+}
+
+ReclamationStats reclamationStats(const HazardPointerDomain& domain) noexcept
+{
+  const auto& state = *DomainState::of(domain);
+
+  auto stats = state.counters.get(state.counters.shared_retired.load(std::memory_order_relaxed), 0);
+  stats.records_high_water = state.records.highWater();
+
+  return stats;
+}
+
 void ReclaimList::addNode(Node* const node) noexcept
 {
   node->next = head_.load(std::memory_order_relaxed);
 
-  while (!head_.compare_exchange_weak(node->next, node, 
-                                      std::memory_order_release, 
+  while (!head_.compare_exchange_weak(node->next, node,
+                                      std::memory_order_release,
                                       std::memory_order_relaxed));
 }
 
-void ReclaimList::reclaimIfPossible() noexcept
+void ReclaimList::reclaimIfPossible(const HazardPointerDomain& domain) noexcept
 {
   Node* old_head = head_.exchange(nullptr, std::memory_order_acquire);
 
+  if (!old_head)
+  {
+    return;
+  }
+
+  const auto begin = std::chrono::steady_clock::now();
+  auto& state = *DomainState::of(domain);
+  const HazardSnapshot snapshot{state};
+
+  std::size_t reclaimed{};
   for (; old_head;)
   {
     Node* next = old_head->next;
 
-    if (!otherHazardPoints(old_head))
+    if (!snapshot.contains(old_head->getData()))
     {
-      delete old_head;
+      old_head->reclaim();
+      ++reclaimed;
     }
     else
     {
@@ -99,16 +364,24 @@ void ReclaimList::reclaimIfPossible() noexcept
 
     old_head = next;
   }
+
+  state.counters.shared_retired.fetch_sub(reclaimed, std::memory_order_relaxed);
+  state.counters.addScan(reclaimed, begin);
 }
 
-ReclaimList::~ReclaimList()
+void ReclaimList::reclaimAll() noexcept
 {
-  for (Node* old_head = head_.load(); old_head;)
+  for (Node* old_head = head_.exchange(nullptr, std::memory_order_acquire); old_head;)
   {
     auto next = old_head->next;
-    delete old_head;
+    old_head->reclaim();
     old_head = next;
   }
 }
 
+ReclaimList::~ReclaimList()
+{
+  reclaimAll();
+}
+
 }
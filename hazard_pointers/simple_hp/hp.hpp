@@ -1,99 +1,151 @@
 #pragma once
 
 #include <atomic>
-#include <functional>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
 #include <thread>
 #include <type_traits>
 
+#include <contention.hpp>
+#include <node.hpp>
+#include <reclamation_stats.hpp>
+
 namespace hazard_pointers
 {
 
+//Records are allocated on demand, so it is not thrown anymore. Kept for code which catches it.
 class NoFreeHazardPointer : public std::exception
 {
   using exception::exception;
 };
 
+//Record of each thread keeps its slots on its own cache line
+constexpr std::size_t max_slots_per_thread{7};
+constexpr std::size_t default_slots_per_thread{3};
+
+class HazardPointerDomain;
+
 namespace detail
 {
 
-class ReclaimList final
-{
-  class Node final
-  {
-   private:
-    template <typename T>
-    static void deleteHelper(const void* const data)
-    {
-      delete static_cast<const T*>(data);
-    }
+struct DomainState;
 
-    std::function<void(const void*)> deleter;
-    const void* const data;
+using Node = BasicNode<NoStamps>;
 
-   public:
-    Node* next{};
+void retire(HazardPointerDomain& domain, Node* node) noexcept;
 
-    template <typename T>
-    Node(const T* const data) noexcept : deleter{&deleteHelper<T>}, data{data} {}
+}
 
-    ~Node()
-    {
-      deleter(data);
-    }
-  };
+}
+
+#include <reclaimable.hpp>
 
+namespace hazard_pointers
+{
+
+namespace detail
+{
+
+class ReclaimList final
+{
   std::atomic<Node*> head_{};
 
-  void addNode(Node* const node) noexcept;
  public:
-  
-  template <typename T>
-  void add(const T* const data)
-  {
-    Node* new_node = new Node{data};
-    addNode(new_node);
-  }
+  void addNode(Node* const node) noexcept;
+
+  void reclaimIfPossible(const HazardPointerDomain& domain) noexcept;
 
-  void reclaimIfPossible() noexcept;
+  //Only when nobody can point to retired objects anymore
+  void reclaimAll() noexcept;
 
   ~ReclaimList();
 };
 
-inline ReclaimList reclaim_list{};
+ReclaimList& getReclaimList(HazardPointerDomain& domain) noexcept;
+
+}
+
+//Hazard pointers of a domain are checked only against objects retired to the same domain,
+//so data structures with own domains don't walk records of each other
+class HazardPointerDomain final
+{
+ public:
+  explicit HazardPointerDomain(std::size_t slots_per_thread = default_slots_per_thread);
+  ~HazardPointerDomain();
+
+  HazardPointerDomain(const HazardPointerDomain&) = delete;
+  HazardPointerDomain& operator=(const HazardPointerDomain&) = delete;
+
+  std::size_t slotsPerThread() const noexcept;
+
+ private:
+  friend struct detail::DomainState;
+
+  //Threads keep state alive until they release their records
+  std::shared_ptr<detail::DomainState> state_;
+};
+
+HazardPointerDomain& defaultDomain();
+
+bool otherHazardPoints(const HazardPointerDomain& domain, const void* const p) noexcept;
+std::atomic<void*>& getHazardPointerForCurrentThread(HazardPointerDomain& domain, std::size_t slot);
 
+inline bool otherHazardPoints(const void* const p) noexcept
+{
+  return otherHazardPoints(defaultDomain(), p);
 }
 
+inline std::atomic<void*>& getHazardPointerForCurrentThread()
+{
+  return getHazardPointerForCurrentThread(defaultDomain(), 0);
+}
 
-bool otherHazardPoints(const void* const p) noexcept;
-std::atomic<void*>& getHazardPointerForCurrentThread();
+//Publishes p in slot, caller has to check that p is still reachable after that
+inline void publish(HazardPointerDomain& domain, const std::size_t slot, const void* const p)
+{
+  getHazardPointerForCurrentThread(domain, slot).store(const_cast<void*>(p));
+}
 
-template <typename T>
-void addToReclaimList(const T* const data) noexcept
+//Returns pointer loaded from src which stays valid until slot is changed or cleared
+template <typename T, typename Counting = contention::Mode>
+T* protect(HazardPointerDomain& domain, const std::size_t slot, const std::atomic<T*>& src)
 {
-  static_assert(std::is_nothrow_destructible_v<T>, "destructor of T must not throw");
+  std::atomic<void*>& hp = getHazardPointerForCurrentThread(domain, slot);
+
+  T* p = src.load();
   for (;;)
   {
-    if (!otherHazardPoints(data))
-    {
-      delete data;
-      break;
-    }
+    hp.store(p);
 
-    try
-    {
-      detail::reclaim_list.add(data);
-      break;
-    }
-    catch (const std::bad_alloc&)
+    T* const temp = src.load();
+    if (temp == p)
     {
+      return p;
     }
+
+    contention::count(contention::Event::validation_retry);
+    p = temp;
   }
 }
 
+//Clears all hazard pointers of current thread in the domain
+void clearHazardPointers(HazardPointerDomain& domain) noexcept;
+
+//Reclaims every retired object of the domain visible to current thread which is not protected,
+//hazard pointers of current thread are kept
+void scan(HazardPointerDomain& domain) noexcept;
+
+inline void reclaimIfPossible(HazardPointerDomain& domain) noexcept
+{
+  clearHazardPointers(domain);
+  detail::getReclaimList(domain).reclaimIfPossible(domain);
+}
+
 inline void reclaimIfPossible() noexcept
 {
-  getHazardPointerForCurrentThread().exchange(nullptr, std::memory_order_relaxed);
-  detail::reclaim_list.reclaimIfPossible();
+  reclaimIfPossible(defaultDomain());
 }
 
 }
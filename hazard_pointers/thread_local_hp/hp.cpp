@@ -1,6 +1,30 @@
 #include <hp.hpp>
-
-constexpr int max_nuf_of_threads{128};
+#include <reclamation_counters.hpp>
+#include <registry.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <limits>
+#include <new>
+#include <stdexcept>
+#include <vector>
+
+#if defined(HAZARD_POINTERS_ASYMMETRIC_FENCES) && defined(__linux__)
+#include <linux/membarrier.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+using hazard_pointers::detail::cache_line_size;
+#if defined(HAZARD_POINTERS_ASYMMETRIC_FENCES)
+//Every scan costs heavy fence, so it is amortized over more objects
+constexpr std::size_t min_scan_threshold{512};
+#else
+constexpr std::size_t min_scan_threshold{128};
+#endif
+//Objects of exited threads over this many scan thresholds make every retiring thread scan
+constexpr std::size_t orphan_backlog_cap{4};
 
 namespace hazard_pointers
 {
@@ -8,135 +32,508 @@ namespace hazard_pointers
 namespace
 {
 
-struct HazardPointer
+struct alignas(cache_line_size) HazardRecord
 {
   std::atomic<std::thread::id> thread_id{};
-  std::atomic<void*> pointer{};
+  std::atomic<void*> pointers[max_slots_per_thread]{};
+  //Size of reclaim list of the owner, it changes on every retire, so scans don't read its line
+  alignas(cache_line_size) std::atomic<std::size_t> retired{};
 };
 
-HazardPointer pointers[max_nuf_of_threads];
+static_assert(sizeof(HazardRecord) == 2 * cache_line_size, "hazard pointers must take exactly one cache line");
 
-class HPOwner final
+}
+
+struct detail::DomainState
+{
+  const std::size_t slots_per_thread;
+  std::atomic<bool> domain_alive{true};
+  detail::Registry<HazardRecord> records;
+  //Lists of exited threads wait here for other threads of the domain
+  ThreadSafeReclaimList global_reclaim_list;
+  ReclamationCounters counters;
+
+  explicit DomainState(const std::size_t slots_per_thread) : slots_per_thread{slots_per_thread} {}
+
+  static const std::shared_ptr<DomainState>& of(const HazardPointerDomain& domain) noexcept
+  {
+    return domain.state_;
+  }
+
+  std::size_t retired() const noexcept
+  {
+    std::size_t result = counters.shared_retired.load(std::memory_order_relaxed);
+    records.forEach([&result](const HazardRecord& record) {
+      result += record.retired.load(std::memory_order_relaxed);
+    });
+
+    return result;
+  }
+};
+
+using DomainState = detail::DomainState;
+using ReclaimList = detail::ReclaimList;
+using OrphanBatch = detail::OrphanBatch;
+
+namespace
+{
+
+//Thread scans its list when it has this many objects, so each scan frees at least half of them.
+//Objects of exited threads are adopted by chunks of the same size.
+std::size_t scanThreshold(const DomainState& state) noexcept
+{
+  return std::max(min_scan_threshold, 2 * state.records.highWater() * state.slots_per_thread);
+}
+
+//Joins chain of batches into the first one, returns it
+OrphanBatch* mergeBatches(OrphanBatch* const batches) noexcept
+{
+  if (!batches)
+  {
+    return nullptr;
+  }
+
+  for (OrphanBatch* next = batches->next; next; next = batches->next)
+  {
+    batches->tail->next = next->head;
+    batches->tail = next->tail;
+    batches->size += next->size;
+    batches->next = next->next;
+    delete next;
+  }
+
+  return batches;
+}
+
+//Pairs with publication of hazard pointers by all threads, sequentially consistent
+//publication needs nothing more
+void heavyFence() noexcept
+{
+#if defined(HAZARD_POINTERS_ASYMMETRIC_FENCES) && defined(__linux__)
+  if (detail::asymmetricFences())
+  {
+    syscall(__NR_membarrier, MEMBARRIER_CMD_PRIVATE_EXPEDITED, 0);
+  }
+#endif
+}
+
+bool otherHazardPoints(const DomainState& state, const void* const p) noexcept
 {
-  int index{};
+  heavyFence();
+
+  return state.records.anyOf([&state, p](const HazardRecord& record) {
+    for (std::size_t i = 0; i < state.slots_per_thread; ++i)
+    {
+      if (p == record.pointers[i].load())
+      {
+        return true;
+      }
+    }
+
+    return false;
+  });
+}
+
+//Hazard pointers published at the moment of scan. Scan of R retired objects costs
+//one pass over records plus R lookups instead of R passes over records.
+class HazardSnapshot final
+{
+  static constexpr std::size_t linear_search_limit{32};
+  static constexpr std::size_t inline_capacity{detail::Registry<HazardRecord>::block_size * max_slots_per_thread};
+
+  std::uintptr_t inline_pointers_[inline_capacity];
+  std::unique_ptr<std::uintptr_t[]> allocated_;
+  std::uintptr_t* pointers_{inline_pointers_};
+  std::size_t size_{};
+  //Snapshot didn't fit into memory, so records are walked on every lookup
+  const DomainState* state_{};
+
  public:
-  HPOwner()
+  explicit HazardSnapshot(const DomainState& state) noexcept
   {
-    for (int i = 0; i < max_nuf_of_threads; ++i)
+    heavyFence();
+
+    //Thread registered after that can't get pointer to object retired before scan
+    const std::size_t capacity = state.records.highWater() * state.slots_per_thread;
+
+    if (capacity > inline_capacity)
     {
-      std::thread::id id{};
-      if (pointers[i].thread_id.compare_exchange_strong(id, std::this_thread::get_id(), 
-                                                        std::memory_order_relaxed))
+      allocated_.reset(new (std::nothrow) std::uintptr_t[capacity]);
+      if (!allocated_)
       {
-        index = i;
+        state_ = &state;
         return;
       }
+      pointers_ = allocated_.get();
+    }
+
+    state.records.forEach([this, &state, capacity](const HazardRecord& record) {
+      for (std::size_t i = 0; i < state.slots_per_thread && size_ < capacity; ++i)
+      {
+        if (const void* const p = record.pointers[i].load())
+        {
+          pointers_[size_++] = reinterpret_cast<std::uintptr_t>(p);
+        }
+      }
+    });
+
+    if (size_ > linear_search_limit)
+    {
+      std::sort(pointers_, pointers_ + size_);
+    }
+  }
+
+  bool contains(const void* const p) const noexcept
+  {
+    if (state_)
+    {
+      return otherHazardPoints(*state_, p);
+    }
+
+    const auto value = reinterpret_cast<std::uintptr_t>(p);
+
+    if (size_ > linear_search_limit)
+    {
+      return std::binary_search(pointers_, pointers_ + size_, value);
+    }
+
+    //No early exit, so compiler vectorizes the loop
+    bool found{};
+    for (std::size_t i = 0; i < size_; ++i)
+    {
+      found |= pointers_[i] == value;
+    }
+
+    return found;
+  }
+};
+
+
+class HPOwner final
+{
+  struct Entry
+  {
+    //Declared first, so reclaim list is handed over while state is still alive
+    std::shared_ptr<DomainState> state;
+    HazardRecord* record;
+    ReclaimList reclaim_list;
+
+    Entry(std::shared_ptr<DomainState> state, HazardRecord& record)
+      : state{std::move(state)}, record{&record}, reclaim_list{*this->state, record.retired}
+    {}
+
+    ~Entry()
+    {
+      //Record is reused by other threads once it is released, so list is emptied before that
+      reclaim_list.handOff();
+
+      for (std::size_t i = 0; i < state->slots_per_thread; ++i)
+      {
+        record->pointers[i].exchange(nullptr, std::memory_order_release);
+      }
+      record->thread_id.exchange(std::thread::id{}, std::memory_order_relaxed);
+      state->records.release();
+    }
+  };
+
+  //Entries are not movable because of reclaim list
+  std::vector<std::unique_ptr<Entry>> entries_;
+
+  static HazardRecord& acquireRecord(DomainState& state)
+  {
+    return state.records.acquire([](HazardRecord& record) {
+      std::thread::id id = record.thread_id.load(std::memory_order_relaxed);
+
+      if (id != std::thread::id{} ||
+          !record.thread_id.compare_exchange_strong(id, std::this_thread::get_id(), std::memory_order_relaxed))
+      {
+        return false;
+      }
+
+      record.retired.store(0, std::memory_order_relaxed);
+      return true;
+    });
+  }
+
+ public:
+  Entry* findEntry(const DomainState& state) const noexcept
+  {
+    for (const auto& entry : entries_)
+    {
+      if (entry->state.get() == &state)
+      {
+        return entry.get();
+      }
     }
-    throw NoFreeHazardPointer{};
+    return nullptr;
   }
 
-  ~HPOwner()
+  Entry& getEntry(const std::shared_ptr<DomainState>& state)
   {
-    pointers[index].pointer.exchange(nullptr, std::memory_order_relaxed);
-    pointers[index].thread_id.exchange(std::thread::id{}, std::memory_order_relaxed);
+    if (Entry* const entry = findEntry(*state))
+    {
+      return *entry;
+    }
+
+    releaseDeadDomains();
+
+    entries_.reserve(entries_.size() + 1);
+    HazardRecord& record = acquireRecord(*state);
+    try
+    {
+      entries_.push_back(std::make_unique<Entry>(state, record));
+    }
+    catch (...)
+    {
+      record.thread_id.store(std::thread::id{}, std::memory_order_relaxed);
+      state->records.release();
+      throw;
+    }
+
+    return *entries_.back();
   }
 
-  std::atomic<void*>& getPointer() const noexcept
+  void releaseDeadDomains() noexcept
   {
-    return pointers[index].pointer;
+    for (auto it = entries_.begin(); it != entries_.end();)
+    {
+      if ((*it)->state->domain_alive.load(std::memory_order_relaxed))
+      {
+        ++it;
+        continue;
+      }
+
+      it = entries_.erase(it);
+    }
   }
 };
 
+thread_local HPOwner this_thread_hp{};
+
 }
 
-std::atomic<void*>& getHazardPointerForCurrentThread()
+HazardPointerDomain::HazardPointerDomain(const std::size_t slots_per_thread)
 {
-  static thread_local const HPOwner this_thread_hp{};
+  if (!slots_per_thread || slots_per_thread > max_slots_per_thread)
+  {
+    throw std::invalid_argument{"wrong number of hazard pointers per thread"};
+  }
 
-  return this_thread_hp.getPointer();
+  state_.reset(new DomainState{slots_per_thread});
 }
 
-bool otherHazardPoints(const void* const p) noexcept
+//Data structures of the domain are gone, so nobody points to retired objects. Lists of
+//threads which are still running are reclaimed when they exit or release the domain.
+HazardPointerDomain::~HazardPointerDomain()
 {
-  for (int i = 0; i < max_nuf_of_threads; ++i)
+  state_->domain_alive.store(false, std::memory_order_relaxed);
+  state_->global_reclaim_list.reclaimAll();
+}
+
+std::size_t HazardPointerDomain::slotsPerThread() const noexcept
+{
+  return state_->slots_per_thread;
+}
+
+HazardPointerDomain& defaultDomain()
+{
+  static HazardPointerDomain domain{};
+
+  return domain;
+}
+
+#if defined(HAZARD_POINTERS_ASYMMETRIC_FENCES)
+bool detail::registerAsymmetricFences() noexcept
+{
+#if defined(__linux__)
+  const long commands = syscall(__NR_membarrier, MEMBARRIER_CMD_QUERY, 0);
+
+  return commands > 0 && (commands & MEMBARRIER_CMD_PRIVATE_EXPEDITED) &&
+         !syscall(__NR_membarrier, MEMBARRIER_CMD_REGISTER_PRIVATE_EXPEDITED, 0);
+#else
+  return false;
+#endif
+}
+#endif
+
+std::atomic<void*>& getHazardPointerForCurrentThread(HazardPointerDomain& domain, const std::size_t slot)
+{
+  const auto& state = DomainState::of(domain);
+
+  if (slot >= state->slots_per_thread)
+  {
+    throw std::out_of_range{"no such hazard pointer slot in the domain"};
+  }
+
+  return this_thread_hp.getEntry(state).record->pointers[slot];
+}
+
+void clearHazardPointers(HazardPointerDomain& domain) noexcept
+{
+  const auto& state = DomainState::of(domain);
+
+  if (const auto entry = this_thread_hp.findEntry(*state))
   {
-    if (p == pointers[i].pointer.load())
+    for (std::size_t i = 0; i < state->slots_per_thread; ++i)
     {
-      return true;
+      entry->record->pointers[i].store(nullptr, std::memory_order_release);
     }
   }
+}
 
-  return false;
+bool otherHazardPoints(const HazardPointerDomain& domain, const void* const p) noexcept
+{
+  return otherHazardPoints(*DomainState::of(domain), p);
 }
 
-using ThreadSafeReclaimList = detail::ThreadSafeReclaimList;
+ReclaimList& detail::getThreadReclaimList(HazardPointerDomain& domain)
+{
+  return this_thread_hp.getEntry(DomainState::of(domain)).reclaim_list;
+}
 
-void ThreadSafeReclaimList::addNode(Node* const node) noexcept
+void detail::retire(HazardPointerDomain& domain, Node* const node)
 {
-  node->next = head_.load(std::memory_order_relaxed);
+  getThreadReclaimList(domain).addNode(node);
+}
 
-  while (!head_.compare_exchange_weak(node->next, node, 
-                                      std::memory_order_release, 
-                                      std::memory_order_relaxed));
+//Nothing is freed by waiting, but unprotected object needs no list
+bool detail::onRetireFailure(HazardPointerDomain& domain, const void* const data) noexcept
+{
+  return !otherHazardPoints(domain, data);
 }
 
-void ThreadSafeReclaimList::addNodes(Node* const head) noexcept
+ReclamationStats reclamationStats(const HazardPointerDomain& domain) noexcept
 {
-  if (!head)
+  const auto& state = DomainState::of(domain);
+  const auto entry = this_thread_hp.findEntry(*state);
+
+  auto stats = state->counters.get(state->retired(),
+                                  entry ? entry->record->retired.load(std::memory_order_relaxed) : 0);
+  stats.records_high_water = state->records.highWater();
+
+  return stats;
+}
+
+void scan(HazardPointerDomain& domain) noexcept
+{
+  const auto& state = DomainState::of(domain);
+
+  if (const auto entry = this_thread_hp.findEntry(*state))
   {
-    return;
+    entry->reclaim_list.acceptFromGlobal(std::numeric_limits<std::size_t>::max());
+    entry->reclaim_list.scan();
   }
+  else
+  {
+    state->global_reclaim_list.reclaimIfPossible(*state);
+  }
+}
 
-  Node* tail{head};
-  for (Node* next = head->next; next; tail = next, next = next->next);
+using ThreadSafeReclaimList = detail::ThreadSafeReclaimList;
 
-  tail->next = head_.load(std::memory_order_relaxed);
-  while (!head_.compare_exchange_weak(tail->next, head,
+void ThreadSafeReclaimList::addBatch(OrphanBatch* const batch) noexcept
+{
+  batch->next = head_.load(std::memory_order_relaxed);
+
+  while (!head_.compare_exchange_weak(batch->next, batch,
                                       std::memory_order_release,
                                       std::memory_order_relaxed));
 }
 
-void ThreadSafeReclaimList::reclaimIfPossible() noexcept
+void ThreadSafeReclaimList::reclaimIfPossible(DomainState& state) noexcept
 {
-  Node* old_head = head_.exchange(nullptr, std::memory_order_acquire);
+  OrphanBatch* const batch = mergeBatches(exchange());
+
+  if (!batch)
+  {
+    return;
+  }
+
+  const auto begin = std::chrono::steady_clock::now();
+  const HazardSnapshot snapshot{state};
 
+  Node* old_head = batch->head;
+  batch->head = nullptr;
+  batch->tail = nullptr;
+  batch->size = 0;
+
+  std::size_t reclaimed{};
   for (; old_head;)
   {
     Node* next = old_head->next;
 
-    if (!otherHazardPoints(old_head))
+    if (!snapshot.contains(old_head->getData()))
     {
-      delete old_head;
+      old_head->reclaim();
+      ++reclaimed;
     }
     else
     {
-      add(old_head);
+      if (!batch->head)
+      {
+        batch->tail = old_head;
+      }
+      old_head->next = batch->head;
+      batch->head = old_head;
+      ++batch->size;
     }
 
     old_head = next;
   }
+
+  if (batch->head)
+  {
+    addBatch(batch);
+  }
+  else
+  {
+    delete batch;
+  }
+
+  state.counters.shared_retired.fetch_sub(reclaimed, std::memory_order_relaxed);
+  state.counters.addScan(reclaimed, begin);
 }
 
-detail::Node* ThreadSafeReclaimList::exchange() noexcept
+OrphanBatch* ThreadSafeReclaimList::exchange() noexcept
 {
+  //Retiring threads check the list all the time, so its line isn't written while it is empty
+  if (!head_.load(std::memory_order_relaxed))
+  {
+    return nullptr;
+  }
+
   return head_.exchange(nullptr, std::memory_order_acquire);
 }
 
-ThreadSafeReclaimList::~ThreadSafeReclaimList()
+void ThreadSafeReclaimList::reclaimAll() noexcept
 {
-  for (Node* old_head = head_.load(); old_head;)
+  for (OrphanBatch* batch = exchange(); batch;)
   {
-    auto next = old_head->next;
-    delete old_head;
-    old_head = next;
+    for (Node* node = batch->head; node;)
+    {
+      auto next = node->next;
+      node->reclaim();
+      node = next;
+    }
+
+    auto next = batch->next;
+    delete batch;
+    batch = next;
   }
 }
 
-using ReclaimList = detail::ReclaimList;
+ThreadSafeReclaimList::~ThreadSafeReclaimList()
+{
+  reclaimAll();
+}
 
 void ReclaimList::addNode(Node* const node) noexcept
 {
-  ++size_;
+  if (!head_)
+  {
+    tail_ = node;
+  }
+  setSize(size_ + 1);
   node->next = head_;
   head_ = node;
 }
@@ -146,56 +543,147 @@ std::size_t ReclaimList::size() const noexcept
   return size_;
 }
 
-void ReclaimList::acceptFromGlobal() noexcept
+void ReclaimList::setSize(const std::size_t size) noexcept
 {
-  auto global_list = global_reclaim_list.exchange();
+  size_ = size;
+  published_size_.store(size, std::memory_order_relaxed);
+}
 
-  if (!global_list)
+void ReclaimList::splice(Node* const first, Node* const last, const std::size_t size) noexcept
+{
+  if (!head_)
   {
-    return;
+    tail_ = last;
   }
+  last->next = head_;
+  head_ = first;
+  setSize(size_ + size);
+}
+
+std::size_t ReclaimList::acceptFromGlobal(const std::size_t max_nodes) noexcept
+{
+  OrphanBatch* batches = state_.global_reclaim_list.exchange();
 
-  std::size_t delta_len{};
-  const auto global_head = global_list;
-  for (auto next = global_list->next; next; global_list = next, next = next->next, ++delta_len);
+  std::size_t accepted{};
+  while (batches && accepted < max_nodes)
+  {
+    OrphanBatch* const batch = batches;
+    const std::size_t limit = max_nodes - accepted;
+
+    if (batch->size <= limit)
+    {
+      batches = batch->next;
+      splice(batch->head, batch->tail, batch->size);
+      accepted += batch->size;
+      delete batch;
+      continue;
+    }
+
+    //Only the beginning of big batch is taken, the rest is left to other threads
+    Node* last = batch->head;
+    for (std::size_t i = 1; i < limit; ++i, last = last->next);
+
+    Node* const first = batch->head;
+    batch->head = last->next;
+    batch->size -= limit;
+    splice(first, last, limit);
+    accepted += limit;
+  }
 
-  global_list->next = head_;
-  head_ = global_head;
-  size_ += delta_len;
+  if (batches)
+  {
+    state_.global_reclaim_list.addBatch(mergeBatches(batches));
+  }
+
+  state_.counters.shared_retired.fetch_sub(accepted, std::memory_order_relaxed);
+
+  return accepted;
 }
 
 void ReclaimList::reclaimIfPossible() noexcept
 {
-  Node* old_head = head_;
-  head_ = nullptr;
+  const std::size_t threshold = scanThreshold(state_);
+
+  acceptFromGlobal(threshold);
+
+  //Exited threads left too much, so thread scans even short list to free adopted objects
+  const bool help = state_.counters.shared_retired.load(std::memory_order_relaxed) > orphan_backlog_cap * threshold;
+
+  if (size() < threshold && !help)
+  {
+    return;
+  }
+
+  scan();
+}
 
-  acceptFromGlobal();
+void ReclaimList::scan() noexcept
+{
+  Node* old_head = head_;
 
-  if (size() < max_nuf_of_threads)
+  if (!old_head)
   {
     return;
   }
 
+  //Backlog is the biggest right before scan, so peak is sampled here
+  const auto begin = std::chrono::steady_clock::now();
+  state_.counters.updatePeak(state_.retired());
+
+  const std::size_t old_size = size_;
+  head_ = nullptr;
+  tail_ = nullptr;
+  size_ = 0;
+
+  const HazardSnapshot snapshot{state_};
+
   for (; old_head;)
   {
     Node* next = old_head->next;
 
-    if (!otherHazardPoints(old_head))
+    if (!snapshot.contains(old_head->getData()))
     {
-      delete old_head;
+      old_head->reclaim();
     }
     else
     {
-      addNode(old_head);
+      if (!head_)
+      {
+        tail_ = old_head;
+      }
+      old_head->next = head_;
+      head_ = old_head;
+      ++size_;
     }
 
     old_head = next;
   }
+
+  setSize(size_);
+  state_.counters.addScan(old_size - size_, begin);
 }
 
-ReclaimList::~ReclaimList()
+//Exiting thread protects nothing, so other threads get only objects which they protect.
+//Nodes of dead domain are reclaimed together with its state.
+void ReclaimList::handOff() noexcept
 {
-  global_reclaim_list.addNodes(head_);
+  scan();
+
+  if (head_)
+  {
+    batch_->head = head_;
+    batch_->tail = tail_;
+    batch_->size = size_;
+
+    state_.counters.handed_off.fetch_add(size_, std::memory_order_relaxed);
+    state_.counters.shared_retired.fetch_add(size_, std::memory_order_relaxed);
+    state_.global_reclaim_list.addBatch(batch_.release());
+
+    head_ = nullptr;
+    tail_ = nullptr;
+    size_ = 0;
+  }
+  setSize(0);
 }
 
 }
@@ -1,125 +1,243 @@
 #pragma once
 
 #include <atomic>
-#include <functional>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
 #include <thread>
 #include <type_traits>
 
+#include <contention.hpp>
+#include <node.hpp>
+#include <reclamation_stats.hpp>
+
 namespace hazard_pointers
 {
 
+//Records are allocated on demand, so it is not thrown anymore. Kept for code which catches it.
 class NoFreeHazardPointer : public std::exception
 {
   using exception::exception;
 };
 
+//Record of each thread keeps its slots on its own cache line
+constexpr std::size_t max_slots_per_thread{7};
+constexpr std::size_t default_slots_per_thread{3};
+
+class HazardPointerDomain;
+
 namespace detail
 {
-class Node final
-{
- private:
-  template <typename T>
-  static void deleteHelper(const void* const data)
-  {
-    delete static_cast<const T*>(data);
-  }
 
-  std::function<void(const void*)> deleter;
-  const void* const data;
+struct DomainState;
 
- public:
-  Node* next{};
+using Node = BasicNode<NoStamps>;
 
-  template <typename T>
-  Node(const T* const data) noexcept : deleter{&deleteHelper<T>}, data{data} {}
+void retire(HazardPointerDomain& domain, Node* node);
 
-  ~Node()
-  {
-    deleter(data);
-  }
+}
+
+}
+
+#include <reclaimable.hpp>
+
+namespace hazard_pointers
+{
+
+namespace detail
+{
+
+//Nodes left by exited thread. Batch knows its tail and size, so it is spliced
+//into other list without walking over its nodes.
+struct OrphanBatch final
+{
+  Node* head{};
+  Node* tail{};
+  std::size_t size{};
+  OrphanBatch* next{};
 };
 
+//Stack of batches, it is only pushed to and exchanged as a whole, so there is no ABA
 class ThreadSafeReclaimList final
 {
-  std::atomic<Node*> head_{};
+  std::atomic<OrphanBatch*> head_{};
 
- public:  
-  template <typename T>
-  void add(const T* const data)
-  {
-    Node* new_node = new Node{data};
-    addNode(new_node);
-  }
-
-  void addNode(Node* const node) noexcept;
+ public:
+  void addBatch(OrphanBatch* const batch) noexcept;
 
-  void addNodes(Node* const head) noexcept;
+  void reclaimIfPossible(DomainState& state) noexcept;
 
-  void reclaimIfPossible() noexcept;
+  OrphanBatch* exchange() noexcept;
 
-  Node* exchange() noexcept;
+  //Only when nobody can point to retired objects anymore
+  void reclaimAll() noexcept;
 
   ~ThreadSafeReclaimList();
 };
 
+//List of objects retired by one thread to one domain
 class ReclaimList final
 {
+  DomainState& state_;
   Node* head_{};
+  Node* tail_{};
   std::size_t size_{};
+  //Copy of size for reclamationStats, written only by owner
+  std::atomic<std::size_t>& published_size_;
+  //Allocated beforehand, so exiting thread hands over its list without allocation
+  std::unique_ptr<OrphanBatch> batch_;
 
   std::size_t size() const noexcept;
-
-  void acceptFromGlobal() noexcept;
+  void setSize(std::size_t size) noexcept;
+  void splice(Node* first, Node* last, std::size_t size) noexcept;
  public:
-  template <typename T>
-  void add(const T* const data)
-  {
-    Node* new_node = new Node{data};
-    addNode(new_node);
-  }
+  ReclaimList(DomainState& state, std::atomic<std::size_t>& published_size)
+    : state_{state}, published_size_{published_size}, batch_{new OrphanBatch}
+  {}
+
+  ReclaimList(const ReclaimList&) = delete;
+  ReclaimList& operator=(const ReclaimList&) = delete;
 
   void addNode(Node* const node) noexcept;
 
+  //Takes at most max_nodes objects of exited threads, returns number of taken ones
+  std::size_t acceptFromGlobal(std::size_t max_nodes) noexcept;
+
   void reclaimIfPossible() noexcept;
 
-  ~ReclaimList();
+  //Checks every retired object regardless of size of the list
+  void scan() noexcept;
+
+  //Gives objects still protected by others to the domain. Owner calls it before its record
+  //can be taken by another thread, because list writes its size to the record.
+  void handOff() noexcept;
+};
+
+ReclaimList& getThreadReclaimList(HazardPointerDomain& domain);
+
+}
+
+
+//Hazard pointers of a domain are checked only against objects retired to the same domain,
+//so data structures with own domains don't walk records of each other
+class HazardPointerDomain final
+{
+ public:
+  explicit HazardPointerDomain(std::size_t slots_per_thread = default_slots_per_thread);
+  ~HazardPointerDomain();
+
+  HazardPointerDomain(const HazardPointerDomain&) = delete;
+  HazardPointerDomain& operator=(const HazardPointerDomain&) = delete;
+
+  std::size_t slotsPerThread() const noexcept;
+
+ private:
+  friend struct detail::DomainState;
+
+  //Threads keep state alive until they release their records and hand over their lists
+  std::shared_ptr<detail::DomainState> state_;
 };
 
-inline ThreadSafeReclaimList global_reclaim_list{};
-inline thread_local ReclaimList thread_reclaim_list{};
+HazardPointerDomain& defaultDomain();
 
+bool otherHazardPoints(const HazardPointerDomain& domain, const void* const p) noexcept;
+std::atomic<void*>& getHazardPointerForCurrentThread(HazardPointerDomain& domain, std::size_t slot);
+
+inline bool otherHazardPoints(const void* const p) noexcept
+{
+  return otherHazardPoints(defaultDomain(), p);
 }
 
+inline std::atomic<void*>& getHazardPointerForCurrentThread()
+{
+  return getHazardPointerForCurrentThread(defaultDomain(), 0);
+}
 
-bool otherHazardPoints(const void* const p) noexcept;
-std::atomic<void*>& getHazardPointerForCurrentThread();
+namespace detail
+{
+
+//Built with HAZARD_POINTERS_ASYMMETRIC_FENCES hazard pointers are published with plain stores.
+//Scan issues membarrier, which makes every running thread of the process execute full fence,
+//before it reads hazard pointers, so readers don't pay for fence on each publication.
+//Without membarrier publication is sequentially consistent store as in the default build.
+#if defined(HAZARD_POINTERS_ASYMMETRIC_FENCES)
+//Registers process for expedited membarrier, false when kernel doesn't support it
+bool registerAsymmetricFences() noexcept;
+
+inline bool asymmetricFences() noexcept
+{
+  static const bool enabled{registerAsymmetricFences()};
+
+  return enabled;
+}
+#else
+constexpr bool asymmetricFences() noexcept
+{
+  return false;
+}
+#endif
 
-template <typename T>
-void addToReclaimList(const T* const data) noexcept
+//Orders publication before following loads together with heavy fence of scan
+inline void storeHazardPointer(std::atomic<void*>& hp, void* const p) noexcept
 {
-  static_assert(std::is_nothrow_destructible_v<T>, "destructor of T must not throw");
+  if (asymmetricFences())
+  {
+    hp.store(p, std::memory_order_relaxed);
+    std::atomic_signal_fence(std::memory_order_seq_cst);
+  }
+  else
+  {
+    hp.store(p);
+  }
+}
+
+}
+
+//Publishes p in slot, caller has to check that p is still reachable after that
+inline void publish(HazardPointerDomain& domain, const std::size_t slot, const void* const p)
+{
+  detail::storeHazardPointer(getHazardPointerForCurrentThread(domain, slot), const_cast<void*>(p));
+}
+
+//Returns pointer loaded from src which stays valid until slot is changed or cleared
+template <typename T, typename Counting = contention::Mode>
+T* protect(HazardPointerDomain& domain, const std::size_t slot, const std::atomic<T*>& src)
+{
+  std::atomic<void*>& hp = getHazardPointerForCurrentThread(domain, slot);
+
+  T* p = src.load();
   for (;;)
   {
-    try
-    {
-      detail::thread_reclaim_list.add(data);
-      break;
-    }
-    catch (const std::bad_alloc&)
+    detail::storeHazardPointer(hp, p);
+
+    T* const temp = src.load();
+    if (temp == p)
     {
-      if (!otherHazardPoints(data))
-      {
-        delete data;
-        break;
-      }
+      return p;
     }
+
+    contention::count(contention::Event::validation_retry);
+    p = temp;
   }
 }
 
+//Clears all hazard pointers of current thread in the domain
+void clearHazardPointers(HazardPointerDomain& domain) noexcept;
+
+//Reclaims every retired object of the domain visible to current thread which is not protected,
+//hazard pointers of current thread are kept
+void scan(HazardPointerDomain& domain) noexcept;
+
+inline void reclaimIfPossible(HazardPointerDomain& domain) noexcept
+{
+  clearHazardPointers(domain);
+  detail::getThreadReclaimList(domain).reclaimIfPossible();
+}
+
 inline void reclaimIfPossible() noexcept
 {
-  getHazardPointerForCurrentThread().exchange(nullptr, std::memory_order_relaxed);
-  detail::thread_reclaim_list.reclaimIfPossible();
+  reclaimIfPossible(defaultDomain());
 }
 
 }
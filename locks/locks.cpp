@@ -0,0 +1,85 @@
+#include <locks.hpp>
+
+#include <cstddef>
+#include <new>
+#include <thread>
+
+namespace locks
+{
+
+namespace
+{
+
+using QueueNode = detail::QueueNode;
+
+//Thread which holds this many queue locks at once allocates nodes only on its first lock.
+//Unlock of CLH lock gives node of predecessor back, so the number of nodes of thread stays.
+constexpr std::size_t nodes_per_refill{4};
+
+//Free nodes are linked through next, nobody else looks at them
+class NodeCache final
+{
+  QueueNode* head_{};
+
+  void refill() noexcept
+  {
+    for (std::size_t i = 0; i < nodes_per_refill; ++i)
+    {
+      QueueNode* const node = new (std::nothrow) QueueNode;
+      if (!node)
+      {
+        break;
+      }
+      push(node);
+    }
+  }
+
+ public:
+  //Locks are taken in noexcept code, so thread waits for memory instead of throwing
+  QueueNode* pop() noexcept
+  {
+    while (!head_)
+    {
+      refill();
+      if (!head_)
+      {
+        std::this_thread::yield();
+      }
+    }
+
+    QueueNode* const node = head_;
+    head_ = node->next.load(std::memory_order_relaxed);
+
+    return node;
+  }
+
+  void push(QueueNode* const node) noexcept
+  {
+    node->next.store(head_, std::memory_order_relaxed);
+    head_ = node;
+  }
+
+  ~NodeCache()
+  {
+    while (head_)
+    {
+      delete pop();
+    }
+  }
+};
+
+thread_local NodeCache node_cache;
+
+}
+
+QueueNode* detail::acquireNode() noexcept
+{
+  return node_cache.pop();
+}
+
+void detail::releaseNode(QueueNode* const node) noexcept
+{
+  node_cache.push(node);
+}
+
+}
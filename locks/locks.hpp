@@ -0,0 +1,286 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+namespace locks
+{
+
+constexpr std::size_t cache_line_size{64};
+
+//Tells cpu that thread spins: sibling hyperthread gets the core and exit from the loop
+//doesn't pay for misspeculated memory order
+inline void cpuRelax() noexcept
+{
+#if defined(__x86_64__) || defined(__i386__)
+  _mm_pause();
+#elif defined(__aarch64__)
+  asm volatile("yield");
+#endif
+}
+
+//Pauses first and yields later, so waiters don't take cpu from preempted lock holder
+//when there are more threads than cpus
+class SpinWait final
+{
+  static constexpr unsigned spins_before_yield{1024};
+
+  unsigned spins_{};
+
+ public:
+  void wait() noexcept
+  {
+    if (spins_ < spins_before_yield)
+    {
+      ++spins_;
+      cpuRelax();
+      return;
+    }
+
+    std::this_thread::yield();
+  }
+};
+
+//Test-and-test-and-set lock. Waiters spin on their cached copy of the flag and write it only
+//when it looks free, thread which lost the race doubles its pause up to the limit.
+class TtasLock final
+{
+  static constexpr unsigned min_backoff{4};
+  static constexpr unsigned max_backoff{1024};
+
+  alignas(cache_line_size) std::atomic<bool> locked_{};
+
+ public:
+  TtasLock() = default;
+
+  TtasLock(const TtasLock&) = delete;
+  TtasLock& operator=(const TtasLock&) = delete;
+
+  void lock() noexcept
+  {
+    SpinWait spin;
+    for (unsigned backoff = min_backoff;; backoff = std::min(backoff * 2, max_backoff))
+    {
+      while (locked_.load(std::memory_order_relaxed))
+      {
+        spin.wait();
+      }
+
+      if (!locked_.exchange(true, std::memory_order_acquire))
+      {
+        return;
+      }
+
+      for (unsigned i = 0; i < backoff; ++i)
+      {
+        cpuRelax();
+      }
+    }
+  }
+
+  bool try_lock() noexcept
+  {
+    return !locked_.load(std::memory_order_relaxed) && !locked_.exchange(true, std::memory_order_acquire);
+  }
+
+  void unlock() noexcept
+  {
+    locked_.store(false, std::memory_order_release);
+  }
+};
+
+//Threads get the lock in order of their tickets. Everybody spins on the same counter,
+//so waiter far from the head of the queue checks it less often.
+class TicketLock final
+{
+  static constexpr unsigned pause_per_waiter{32};
+
+  alignas(cache_line_size) std::atomic<std::uint32_t> next_{};
+  alignas(cache_line_size) std::atomic<std::uint32_t> serving_{};
+
+ public:
+  TicketLock() = default;
+
+  TicketLock(const TicketLock&) = delete;
+  TicketLock& operator=(const TicketLock&) = delete;
+
+  void lock() noexcept
+  {
+    const std::uint32_t ticket = next_.fetch_add(1, std::memory_order_relaxed);
+
+    SpinWait spin;
+    for (std::uint32_t serving; (serving = serving_.load(std::memory_order_acquire)) != ticket;)
+    {
+      for (std::uint32_t i = 0; i < (ticket - serving - 1) * pause_per_waiter; ++i)
+      {
+        cpuRelax();
+      }
+      spin.wait();
+    }
+  }
+
+  bool try_lock() noexcept
+  {
+    std::uint32_t serving = serving_.load(std::memory_order_relaxed);
+
+    return next_.compare_exchange_strong(serving, serving + 1, std::memory_order_acquire, std::memory_order_relaxed);
+  }
+
+  //Only owner changes serving_
+  void unlock() noexcept
+  {
+    serving_.store(serving_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+  }
+};
+
+namespace detail
+{
+
+struct alignas(cache_line_size) QueueNode final
+{
+  std::atomic<QueueNode*> next{};
+  std::atomic<bool> locked{};
+};
+
+//Every thread caches free nodes, they are freed when it exits. Nodes are allocated in
+//batches on the first lock of thread, when memory is exhausted thread waits for it.
+QueueNode* acquireNode() noexcept;
+void releaseNode(QueueNode* node) noexcept;
+
+}
+
+//MCS queue lock: every waiter spins on flag of its own node and owner passes the lock to
+//the next node, so waiting doesn't move cache lines between cpus
+class McsLock final
+{
+  alignas(cache_line_size) std::atomic<detail::QueueNode*> tail_{};
+  //Written and read only by owner
+  detail::QueueNode* owner_node_{};
+
+ public:
+  McsLock() = default;
+
+  McsLock(const McsLock&) = delete;
+  McsLock& operator=(const McsLock&) = delete;
+
+  void lock() noexcept
+  {
+    detail::QueueNode* const node = detail::acquireNode();
+    node->next.store(nullptr, std::memory_order_relaxed);
+    node->locked.store(true, std::memory_order_relaxed);
+
+    if (detail::QueueNode* const predecessor = tail_.exchange(node, std::memory_order_acq_rel))
+    {
+      predecessor->next.store(node, std::memory_order_release);
+
+      SpinWait spin;
+      while (node->locked.load(std::memory_order_acquire))
+      {
+        spin.wait();
+      }
+    }
+
+    owner_node_ = node;
+  }
+
+  bool try_lock() noexcept
+  {
+    detail::QueueNode* const node = detail::acquireNode();
+    node->next.store(nullptr, std::memory_order_relaxed);
+
+    detail::QueueNode* expected{};
+    if (!tail_.compare_exchange_strong(expected, node, std::memory_order_acquire, std::memory_order_relaxed))
+    {
+      detail::releaseNode(node);
+      return false;
+    }
+
+    owner_node_ = node;
+
+    return true;
+  }
+
+  void unlock() noexcept
+  {
+    detail::QueueNode* const node = owner_node_;
+    detail::QueueNode* next = node->next.load(std::memory_order_acquire);
+
+    if (!next)
+    {
+      detail::QueueNode* expected = node;
+      if (tail_.compare_exchange_strong(expected, nullptr, std::memory_order_release, std::memory_order_relaxed))
+      {
+        detail::releaseNode(node);
+        return;
+      }
+
+      //Next thread has taken tail_ but hasn't linked its node yet
+      SpinWait spin;
+      while (!(next = node->next.load(std::memory_order_acquire)))
+      {
+        spin.wait();
+      }
+    }
+
+    next->locked.store(false, std::memory_order_release);
+    detail::releaseNode(node);
+  }
+};
+
+//CLH queue lock: waiter spins on node of its predecessor and takes that node after unlock,
+//while its own node stays in the queue for the next thread. Only BasicLockable: try_lock
+//would have to read tail node which may be reused by other thread at the same time.
+class ClhLock final
+{
+  alignas(cache_line_size) std::atomic<detail::QueueNode*> tail_;
+  //Written and read only by owner
+  detail::QueueNode* owner_node_{};
+  detail::QueueNode* owner_predecessor_{};
+
+ public:
+  //Queue always ends with node of the last owner, the first one is unlocked dummy
+  ClhLock() : tail_{new detail::QueueNode} {}
+
+  ClhLock(const ClhLock&) = delete;
+  ClhLock& operator=(const ClhLock&) = delete;
+
+  void lock() noexcept
+  {
+    detail::QueueNode* const node = detail::acquireNode();
+    node->locked.store(true, std::memory_order_relaxed);
+
+    detail::QueueNode* const predecessor = tail_.exchange(node, std::memory_order_acq_rel);
+
+    SpinWait spin;
+    while (predecessor->locked.load(std::memory_order_acquire))
+    {
+      spin.wait();
+    }
+
+    owner_node_ = node;
+    owner_predecessor_ = predecessor;
+  }
+
+  void unlock() noexcept
+  {
+    detail::QueueNode* const predecessor = owner_predecessor_;
+    owner_node_->locked.store(false, std::memory_order_release);
+
+    //Nobody looks at node of predecessor anymore
+    detail::releaseNode(predecessor);
+  }
+
+  ~ClhLock()
+  {
+    delete tail_.load(std::memory_order_relaxed);
+  }
+};
+
+}
@@ -0,0 +1,267 @@
+#include <pool.hpp>
+
+#include <atomic>
+#include <cstdint>
+#include <new>
+
+constexpr std::size_t num_of_size_classes{node_pool::max_block_size / node_pool::block_alignment};
+constexpr std::size_t slab_size{64 * 1024};
+constexpr std::size_t batch_size{64};
+constexpr std::size_t max_cached_blocks{2 * batch_size};
+constexpr std::size_t cache_line_size{64};
+
+namespace node_pool
+{
+
+namespace
+{
+
+struct FreeBlock
+{
+  FreeBlock* next;
+  //Is used only by first block of batch in global list. It can be read by thread which lost
+  //race for the batch, so it is atomic. Memory of blocks is never returned to the system.
+  std::atomic<FreeBlock*> next_batch;
+};
+
+static_assert(sizeof(FreeBlock) <= block_alignment, "free block must fit into smallest block");
+
+struct TaggedBatch
+{
+  FreeBlock* head{};
+  std::uintptr_t tag{};
+};
+
+struct alignas(cache_line_size) SizeClass
+{
+  std::atomic<TaggedBatch> batches{};
+  //Slabs are never freed, list keeps them reachable
+  std::atomic<void*> slabs{};
+};
+
+SizeClass size_classes[num_of_size_classes];
+
+struct ThreadCache
+{
+  FreeBlock* head;
+  std::size_t count;
+};
+
+//Both are trivially destructible, so they are usable from destructors of other thread locals
+//and statics after cache of thread has been flushed
+thread_local ThreadCache caches[num_of_size_classes]{};
+thread_local bool cache_is_flushed{};
+
+constexpr std::size_t sizeClassIndex(const std::size_t size) noexcept
+{
+  return size ? (size - 1) / block_alignment : 0;
+}
+
+constexpr std::size_t blockSize(const std::size_t index) noexcept
+{
+  return (index + 1) * block_alignment;
+}
+
+FreeBlock* makeFreeBlock(void* const memory, FreeBlock* const next) noexcept
+{
+  return ::new (memory) FreeBlock{next, {}};
+}
+
+void pushBatch(const std::size_t index, FreeBlock* const head) noexcept
+{
+  auto& batches = size_classes[index].batches;
+
+  TaggedBatch old_head = batches.load(std::memory_order_relaxed);
+  TaggedBatch new_head;
+  do
+  {
+    head->next_batch.store(old_head.head, std::memory_order_relaxed);
+    new_head = TaggedBatch{head, old_head.tag + 1};
+  }
+  while (!batches.compare_exchange_weak(old_head, new_head,
+                                        std::memory_order_release,
+                                        std::memory_order_relaxed));
+}
+
+FreeBlock* popBatch(const std::size_t index) noexcept
+{
+  auto& batches = size_classes[index].batches;
+
+  TaggedBatch old_head = batches.load(std::memory_order_acquire);
+  TaggedBatch new_head;
+  do
+  {
+    if (!old_head.head)
+    {
+      return nullptr;
+    }
+
+    new_head = TaggedBatch{old_head.head->next_batch.load(std::memory_order_relaxed), old_head.tag + 1};
+  }
+  while (!batches.compare_exchange_weak(old_head, new_head,
+                                        std::memory_order_acquire,
+                                        std::memory_order_acquire));
+
+  return old_head.head;
+}
+
+void flushCache(const std::size_t index, ThreadCache& cache) noexcept
+{
+  if (cache.head)
+  {
+    pushBatch(index, cache.head);
+  }
+
+  cache = ThreadCache{};
+}
+
+class CacheFlusher final
+{
+ public:
+  ~CacheFlusher()
+  {
+    for (std::size_t i = 0; i < num_of_size_classes; ++i)
+    {
+      flushCache(i, caches[i]);
+    }
+
+    cache_is_flushed = true;
+  }
+};
+
+void registerCacheFlusher() noexcept
+{
+  static thread_local CacheFlusher flusher{};
+  static_cast<void>(flusher);
+}
+
+void carveSlab(const std::size_t index, ThreadCache& cache)
+{
+  const std::size_t block_size = blockSize(index);
+
+  //First block_alignment bytes keep link to the previous slab
+  auto* const slab = static_cast<std::byte*>(::operator new(slab_size));
+
+  auto& slabs = size_classes[index].slabs;
+  auto* const slab_link = ::new (slab) void*{slabs.load(std::memory_order_relaxed)};
+  while (!slabs.compare_exchange_weak(*slab_link, slab, std::memory_order_relaxed));
+
+  FreeBlock* head{};
+  std::size_t count{};
+  for (std::size_t offset = block_alignment; offset + block_size <= slab_size; offset += block_size)
+  {
+    head = makeFreeBlock(slab + offset, head);
+    ++count;
+  }
+
+  cache.head = head;
+  cache.count = count;
+}
+
+void refill(const std::size_t index, ThreadCache& cache)
+{
+  if (FreeBlock* const batch = popBatch(index))
+  {
+    std::size_t count{};
+    for (auto block = batch; block; block = block->next, ++count);
+
+    cache.head = batch;
+    cache.count = count;
+    return;
+  }
+
+  carveSlab(index, cache);
+}
+
+void* allocateFromGlobal(const std::size_t index)
+{
+  ThreadCache cache{};
+  refill(index, cache);
+
+  FreeBlock* const block = cache.head;
+  cache.head = block->next;
+  if (cache.head)
+  {
+    pushBatch(index, cache.head);
+  }
+
+  return block;
+}
+
+}
+
+void* allocate(const std::size_t size)
+{
+  if (size > max_block_size)
+  {
+    return ::operator new(size);
+  }
+
+  const std::size_t index = sizeClassIndex(size);
+
+  if (cache_is_flushed)
+  {
+    return allocateFromGlobal(index);
+  }
+
+  ThreadCache& cache = caches[index];
+  if (!cache.head)
+  {
+    registerCacheFlusher();
+    refill(index, cache);
+  }
+
+  FreeBlock* const block = cache.head;
+  cache.head = block->next;
+  --cache.count;
+
+  return block;
+}
+
+void deallocate(void* const block, const std::size_t size) noexcept
+{
+  if (!block)
+  {
+    return;
+  }
+
+  if (size > max_block_size)
+  {
+    ::operator delete(block);
+    return;
+  }
+
+  const std::size_t index = sizeClassIndex(size);
+
+  if (cache_is_flushed)
+  {
+    pushBatch(index, makeFreeBlock(block, nullptr));
+    return;
+  }
+
+  ThreadCache& cache = caches[index];
+  if (!cache.head)
+  {
+    registerCacheFlusher();
+  }
+
+  cache.head = makeFreeBlock(block, cache.head);
+
+  if (++cache.count < max_cached_blocks)
+  {
+    return;
+  }
+
+  //Blocks freed by consumer threads go back to producers through global list
+  FreeBlock* const batch = cache.head;
+  FreeBlock* last = batch;
+  for (std::size_t i = 1; i < batch_size; ++i, last = last->next);
+
+  cache.head = last->next;
+  cache.count -= batch_size;
+  last->next = nullptr;
+
+  pushBatch(index, batch);
+}
+
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <type_traits>
+
+namespace node_pool
+{
+
+constexpr std::size_t block_alignment{alignof(std::max_align_t)};
+constexpr std::size_t max_block_size{512};
+
+//Fixed-size blocks are rounded up to block_alignment and served from thread local caches,
+//which are refilled from global lock-free list of freed batches or from new slab.
+//Sizes above max_block_size go to global operator new.
+void* allocate(std::size_t size);
+void deallocate(void* block, std::size_t size) noexcept;
+
+//Stateless allocator, so containers can free nodes from static deleters of reclaim lists
+template <typename T>
+class PoolAllocator
+{
+ public:
+  using value_type = T;
+  using is_always_equal = std::true_type;
+
+  PoolAllocator() noexcept = default;
+
+  template <typename U>
+  PoolAllocator(const PoolAllocator<U>&) noexcept {}
+
+  T* allocate(const std::size_t n)
+  {
+    if (!isPooled(n))
+    {
+      return std::allocator<T>{}.allocate(n);
+    }
+
+    return static_cast<T*>(node_pool::allocate(sizeof(T)));
+  }
+
+  void deallocate(T* const p, const std::size_t n) noexcept
+  {
+    if (!isPooled(n))
+    {
+      std::allocator<T>{}.deallocate(p, n);
+      return;
+    }
+
+    node_pool::deallocate(p, sizeof(T));
+  }
+
+ private:
+  static constexpr bool isPooled(const std::size_t n) noexcept
+  {
+    return n == 1 && alignof(T) <= block_alignment && sizeof(T) <= max_block_size;
+  }
+};
+
+template <typename T, typename U>
+bool operator==(const PoolAllocator<T>&, const PoolAllocator<U>&) noexcept
+{
+  return true;
+}
+
+template <typename T, typename U>
+bool operator!=(const PoolAllocator<T>&, const PoolAllocator<U>&) noexcept
+{
+  return false;
+}
+
+}
@@ -0,0 +1,65 @@
+#include <parking.hpp>
+
+#if defined(__linux__)
+#include <climits>
+
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace parking
+{
+
+#if defined(__linux__)
+
+static_assert(sizeof(std::atomic<std::uint32_t>) == sizeof(std::uint32_t), "futex word must be plain 32 bit");
+
+void Parking::wait(const std::uint32_t ticket) noexcept
+{
+  //Kernel compares the word with ticket, so notify between check and sleep isn't lost
+  if (epoch_.load() == ticket)
+  {
+    syscall(SYS_futex, &epoch_, FUTEX_WAIT_PRIVATE, ticket, nullptr, nullptr, 0);
+  }
+
+  sleepers_.fetch_sub(1, std::memory_order_relaxed);
+}
+
+void Parking::wake(const bool all) noexcept
+{
+  syscall(SYS_futex, &epoch_, FUTEX_WAKE_PRIVATE, all ? INT_MAX : 1, nullptr, nullptr, 0);
+}
+
+#else
+
+void Parking::wait(const std::uint32_t ticket) noexcept
+{
+  {
+    std::unique_lock lock{mutex_};
+    condition_.wait(lock, [this, ticket] { return epoch_.load() != ticket; });
+  }
+
+  sleepers_.fetch_sub(1, std::memory_order_relaxed);
+}
+
+//Lock orders notify with the check of waiter
+void Parking::wake(const bool all) noexcept
+{
+  {
+    std::lock_guard lock{mutex_};
+  }
+
+  if (all)
+  {
+    condition_.notify_all();
+  }
+  else
+  {
+    condition_.notify_one();
+  }
+}
+
+#endif
+
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+#if !defined(__linux__)
+#include <condition_variable>
+#include <mutex>
+#endif
+
+namespace parking
+{
+
+//Idle threads sleep here instead of spinning. Waiter takes ticket, checks its condition once
+//more and sleeps only if nobody has notified since the ticket was taken:
+//
+//  const auto ticket = parking.prepareWait();
+//  if (condition()) { parking.cancelWait(); } else { parking.wait(ticket); }
+//
+//Notifier changes condition before notify. Notify costs one RMW while nobody sleeps.
+class Parking final
+{
+  //Futex word on Linux
+  std::atomic<std::uint32_t> epoch_{};
+  std::atomic<std::uint32_t> sleepers_{};
+#if !defined(__linux__)
+  std::mutex mutex_;
+  std::condition_variable condition_;
+#endif
+
+ public:
+  Parking() = default;
+
+  Parking(const Parking&) = delete;
+  Parking& operator=(const Parking&) = delete;
+
+  std::uint32_t prepareWait() noexcept
+  {
+    sleepers_.fetch_add(1);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+
+    return epoch_.load();
+  }
+
+  void cancelWait() noexcept
+  {
+    sleepers_.fetch_sub(1, std::memory_order_relaxed);
+  }
+
+  //Returns after notify which follows the ticket, may return spuriously
+  void wait(std::uint32_t ticket) noexcept;
+
+  void notifyOne() noexcept
+  {
+    notify(false);
+  }
+
+  void notifyAll() noexcept
+  {
+    notify(true);
+  }
+
+ private:
+  void notify(const bool all) noexcept
+  {
+    epoch_.fetch_add(1);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+
+    if (sleepers_.load(std::memory_order_relaxed))
+    {
+      wake(all);
+    }
+  }
+
+  void wake(bool all) noexcept;
+};
+
+}
@@ -0,0 +1,206 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <optional>
+#include <thread>
+#include <type_traits>
+
+namespace lock_free
+{
+
+//Bounded queue on ring of cells (Vyukov). Sequence of cell tells whose turn it is: pusher of
+//position pos waits for pos, popper waits for pos + 1. Nothing is allocated after construction.
+template <typename T>
+class Queue
+{
+  static_assert(std::is_nothrow_move_constructible_v<T>, "move constructor of T must not throw");
+  static_assert(std::is_nothrow_destructible_v<T>, "destructor of T must not throw");
+
+  struct Cell final
+  {
+    std::atomic<std::size_t> sequence;
+    alignas(T) std::byte storage[sizeof(T)];
+
+    T& value() noexcept
+    {
+      return *std::launder(reinterpret_cast<T*>(storage));
+    }
+  };
+
+  static constexpr std::size_t cache_line_size{64};
+  static constexpr std::size_t default_capacity{1024};
+
+  static std::size_t roundUpToPowerOfTwo(const std::size_t capacity) noexcept
+  {
+    std::size_t result{2};
+    for (; result < capacity; result <<= 1);
+
+    return result;
+  }
+
+  const std::size_t mask_;
+  const std::unique_ptr<Cell[]> cells_;
+  alignas(cache_line_size) std::atomic<std::size_t> enqueue_pos_{};
+  alignas(cache_line_size) std::atomic<std::size_t> dequeue_pos_{};
+
+ public:
+  //Capacity is rounded up to power of two
+  explicit Queue(const std::size_t capacity = default_capacity)
+    : mask_{roundUpToPowerOfTwo(capacity) - 1},
+      cells_{std::make_unique<Cell[]>(mask_ + 1)}
+  {
+    for (std::size_t i = 0; i <= mask_; ++i)
+    {
+      cells_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+  }
+
+  Queue(const Queue&) = delete;
+  Queue& operator=(const Queue&) = delete;
+
+  std::size_t capacity() const noexcept
+  {
+    return mask_ + 1;
+  }
+
+  //Returns false when queue is full
+  bool try_push(T&& data) noexcept
+  {
+    return pushData(std::move(data));
+  }
+
+  bool try_push(const T& data)
+  {
+    T copy{data};
+
+    return pushData(std::move(copy));
+  }
+
+  //Waits while queue is full
+  void push(T&& data) noexcept
+  {
+    while (!try_push(std::move(data)))
+    {
+      std::this_thread::yield();
+    }
+  }
+
+  void push(const T& data)
+  {
+    T copy{data};
+    push(std::move(copy));
+  }
+
+  bool try_pop(T& value) noexcept
+  {
+    static_assert(std::is_nothrow_move_assignable_v<T>, "move assignment of T must not throw");
+
+    return popData([&value](T& data) noexcept { value = std::move(data); });
+  }
+
+  std::optional<T> pop_value() noexcept
+  {
+    std::optional<T> value;
+    popData([&value](T& data) noexcept { value.emplace(std::move(data)); });
+
+    return value;
+  }
+
+  //Compatibility interface, boxes popped value into new allocation
+  std::unique_ptr<T> pop()
+  {
+    auto value = pop_value();
+
+    return value ? std::make_unique<T>(std::move(*value)) : nullptr;
+  }
+
+  ~Queue()
+  {
+    for (std::size_t pos = dequeue_pos_.load(std::memory_order_relaxed);
+         pos != enqueue_pos_.load(std::memory_order_relaxed); ++pos)
+    {
+      cells_[pos & mask_].value().~T();
+    }
+  }
+
+ private:
+  static std::intptr_t distance(const std::size_t sequence, const std::size_t pos) noexcept
+  {
+    return static_cast<std::intptr_t>(sequence - pos);
+  }
+
+  //Value is moved only if position is claimed, so failed try_push leaves data untouched
+  bool pushData(T&& data) noexcept
+  {
+    std::size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+
+    Cell* cell;
+    for (;;)
+    {
+      cell = &cells_[pos & mask_];
+      const std::intptr_t diff = distance(cell->sequence.load(std::memory_order_acquire), pos);
+
+      if (!diff)
+      {
+        if (enqueue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+        {
+          break;
+        }
+      }
+      else if (diff < 0)
+      {
+        return false;
+      }
+      else
+      {
+        pos = enqueue_pos_.load(std::memory_order_relaxed);
+      }
+    }
+
+    ::new (static_cast<void*>(cell->storage)) T(std::move(data));
+    cell->sequence.store(pos + 1, std::memory_order_release);
+
+    return true;
+  }
+
+  template <typename Consumer>
+  bool popData(Consumer&& consume) noexcept
+  {
+    std::size_t pos = dequeue_pos_.load(std::memory_order_relaxed);
+
+    Cell* cell;
+    for (;;)
+    {
+      cell = &cells_[pos & mask_];
+      const std::intptr_t diff = distance(cell->sequence.load(std::memory_order_acquire), pos + 1);
+
+      if (!diff)
+      {
+        if (dequeue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+        {
+          break;
+        }
+      }
+      else if (diff < 0)
+      {
+        return false;
+      }
+      else
+      {
+        pos = dequeue_pos_.load(std::memory_order_relaxed);
+      }
+    }
+
+    consume(cell->value());
+    cell->value().~T();
+    cell->sequence.store(pos + mask_ + 1, std::memory_order_release);
+
+    return true;
+  }
+};
+
+}
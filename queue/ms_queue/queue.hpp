@@ -0,0 +1,239 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <optional>
+#include <stdexcept>
+#include <type_traits>
+
+#include <hp.hpp>
+
+namespace lock_free
+{
+
+//Michael-Scott queue. head_ always points to dummy node, value of the first element lives
+//in the node after it, so push and pop don't touch the same node while queue isn't empty.
+template <typename T, typename Allocator = std::allocator<T>>
+class Queue
+{
+  //Popped node becomes new dummy, its value is destroyed right after pop
+  struct Node final : hazard_pointers::Reclaimable<Node>
+  {
+    alignas(T) std::byte storage[sizeof(T)];
+    std::atomic<Node*> next{};
+
+    Node() noexcept = default;
+
+    template <typename... Args>
+    explicit Node(Args&&... args)
+    {
+      ::new (static_cast<void*>(storage)) T(std::forward<Args>(args)...);
+    }
+
+    T& value() noexcept
+    {
+      return *std::launder(reinterpret_cast<T*>(storage));
+    }
+
+    void destroyValue() noexcept
+    {
+      value().~T();
+    }
+  };
+
+  using NodeAllocator = typename std::allocator_traits<Allocator>::template rebind_alloc<Node>;
+  using NodeAllocatorTraits = std::allocator_traits<NodeAllocator>;
+
+  static_assert(NodeAllocatorTraits::is_always_equal::value, "node allocator must be stateless");
+
+  template <typename... Args>
+  static Node* createNode(Args&&... args)
+  {
+    NodeAllocator allocator;
+    Node* const node = NodeAllocatorTraits::allocate(allocator, 1);
+    try
+    {
+      NodeAllocatorTraits::construct(allocator, node, std::forward<Args>(args)...);
+    }
+    catch (...)
+    {
+      NodeAllocatorTraits::deallocate(allocator, node, 1);
+      throw;
+    }
+
+    return node;
+  }
+
+  static void destroyNode(Node* const node) noexcept
+  {
+    NodeAllocator allocator;
+    NodeAllocatorTraits::destroy(allocator, node);
+    NodeAllocatorTraits::deallocate(allocator, node, 1);
+  }
+
+  static constexpr std::size_t cache_line_size{64};
+
+  hazard_pointers::HazardPointerDomain& domain_;
+  alignas(cache_line_size) std::atomic<Node*> head_;
+  alignas(cache_line_size) std::atomic<Node*> tail_;
+
+ public:
+  Queue() : Queue{hazard_pointers::defaultDomain()} {}
+
+  //Pop needs two hazard pointers: for dummy node and for node with value
+  explicit Queue(hazard_pointers::HazardPointerDomain& domain) : domain_{domain}
+  {
+    if (domain_.slotsPerThread() < 2)
+    {
+      throw std::invalid_argument{"queue needs two hazard pointers per thread"};
+    }
+
+    Node* const dummy = createNode();
+    head_.store(dummy, std::memory_order_relaxed);
+    tail_.store(dummy, std::memory_order_relaxed);
+  }
+
+  Queue(const Queue&) = delete;
+  Queue& operator=(const Queue&) = delete;
+
+  void push(T&& data)
+  {
+    pushNode(createNode(std::move(data)));
+  }
+
+  void push(const T& data)
+  {
+    pushNode(createNode(data));
+  }
+
+  bool try_pop(T& value) noexcept
+  {
+    static_assert(std::is_nothrow_move_assignable_v<T>, "move assignment of T must not throw");
+
+    return popData([&value](T& data) noexcept { value = std::move(data); });
+  }
+
+  std::optional<T> pop_value() noexcept
+  {
+    static_assert(std::is_nothrow_move_constructible_v<T>, "move constructor of T must not throw");
+
+    std::optional<T> value;
+    popData([&value](T& data) noexcept { value.emplace(std::move(data)); });
+
+    return value;
+  }
+
+  //Compatibility interface, boxes popped value into new allocation
+  std::unique_ptr<T> pop()
+  {
+    auto value = pop_value();
+
+    return value ? std::make_unique<T>(std::move(*value)) : nullptr;
+  }
+
+  bool is_lock_free() const noexcept
+  {
+    return head_.is_lock_free() && tail_.is_lock_free();
+  }
+
+  ~Queue()
+  {
+    Node* const dummy = head_.load(std::memory_order_acquire);
+    Node* ptr = dummy->next.load(std::memory_order_relaxed);
+    destroyNode(dummy);
+
+    for (; ptr;)
+    {
+      const auto next = ptr->next.load(std::memory_order_relaxed);
+      ptr->destroyValue();
+      destroyNode(ptr);
+      ptr = next;
+    }
+  }
+
+ private:
+  void pushNode(Node* const node) noexcept
+  {
+    for (;;)
+    {
+      Node* const tail = hazard_pointers::protect(domain_, 0, tail_);
+      Node* next = tail->next.load(std::memory_order_acquire);
+
+      if (next)
+      {
+        //Helps slow pusher which linked node but hasn't moved tail_ yet
+        Node* expected = tail;
+        tail_.compare_exchange_strong(expected, next,
+                                      std::memory_order_release,
+                                      std::memory_order_relaxed);
+        continue;
+      }
+
+      if (tail->next.compare_exchange_weak(next, node,
+                                           std::memory_order_release,
+                                           std::memory_order_relaxed))
+      {
+        Node* expected = tail;
+        tail_.compare_exchange_strong(expected, node,
+                                      std::memory_order_release,
+                                      std::memory_order_relaxed);
+        break;
+      }
+    }
+
+    hazard_pointers::clearHazardPointers(domain_);
+  }
+
+  template <typename Consumer>
+  bool popData(Consumer&& consume) noexcept
+  {
+    static_assert(std::is_nothrow_destructible_v<T>, "destructor of T must not throw");
+
+    for (;;)
+    {
+      Node* const head = hazard_pointers::protect(domain_, 0, head_);
+      Node* const next = head->next.load(std::memory_order_acquire);
+
+      //While head is still dummy its next can't be retired
+      hazard_pointers::publish(domain_, 1, next);
+      if (head != head_.load())
+      {
+        continue;
+      }
+
+      if (!next)
+      {
+        hazard_pointers::clearHazardPointers(domain_);
+        return false;
+      }
+
+      Node* tail = tail_.load(std::memory_order_acquire);
+      if (head == tail)
+      {
+        tail_.compare_exchange_strong(tail, next,
+                                      std::memory_order_release,
+                                      std::memory_order_relaxed);
+        continue;
+      }
+
+      Node* expected = head;
+      if (head_.compare_exchange_strong(expected, next,
+                                        std::memory_order_acquire,
+                                        std::memory_order_relaxed))
+      {
+        //Only thread which moved head_ to next touches its value
+        consume(next->value());
+        next->destroyValue();
+
+        hazard_pointers::addToReclaimList(domain_, head, &destroyNode);
+        hazard_pointers::reclaimIfPossible(domain_);
+
+        return true;
+      }
+    }
+  }
+};
+
+}
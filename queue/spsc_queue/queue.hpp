@@ -0,0 +1,288 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <optional>
+#include <thread>
+#include <type_traits>
+
+namespace lock_free
+{
+
+//Wait-free queue for exactly one pushing and one popping thread. Each side keeps its own
+//position and the last seen position of the other side on its own cache line, so shared
+//positions are read only when cached one says that ring is full or empty.
+template <typename T>
+class Queue
+{
+  static_assert(std::is_nothrow_destructible_v<T>, "destructor of T must not throw");
+
+  static constexpr std::size_t cache_line_size{64};
+  static constexpr std::size_t default_capacity{1024};
+
+  static std::size_t roundUpToPowerOfTwo(const std::size_t capacity) noexcept
+  {
+    std::size_t result{2};
+    for (; result < capacity; result <<= 1);
+
+    return result;
+  }
+
+  struct alignas(cache_line_size) Side final
+  {
+    std::size_t position{};
+    std::size_t cached_other_position{};
+  };
+
+  const std::size_t mask_;
+  T* const buffer_;
+
+  alignas(cache_line_size) std::atomic<std::size_t> head_{};
+  alignas(cache_line_size) std::atomic<std::size_t> tail_{};
+  Side producer_;
+  Side consumer_;
+
+ public:
+  //Contiguous part of ready elements, it stays valid until releaseSpan
+  struct ReadSpan final
+  {
+    T* data;
+    std::size_t size;
+
+    T* begin() const noexcept
+    {
+      return data;
+    }
+
+    T* end() const noexcept
+    {
+      return data + size;
+    }
+
+    bool empty() const noexcept
+    {
+      return !size;
+    }
+  };
+
+  //Capacity is rounded up to power of two
+  explicit Queue(const std::size_t capacity = default_capacity)
+    : mask_{roundUpToPowerOfTwo(capacity) - 1},
+      buffer_{std::allocator<T>{}.allocate(mask_ + 1)}
+  {}
+
+  Queue(const Queue&) = delete;
+  Queue& operator=(const Queue&) = delete;
+
+  std::size_t capacity() const noexcept
+  {
+    return mask_ + 1;
+  }
+
+  //Producer interface
+
+  //Returns false when queue is full
+  bool try_push(T&& data)
+  {
+    return pushData(std::move(data));
+  }
+
+  bool try_push(const T& data)
+  {
+    return pushData(data);
+  }
+
+  //Waits while queue is full
+  void push(T&& data)
+  {
+    while (!try_push(std::move(data)))
+    {
+      std::this_thread::yield();
+    }
+  }
+
+  void push(const T& data)
+  {
+    while (!try_push(data))
+    {
+      std::this_thread::yield();
+    }
+  }
+
+  //Pushes as many elements as fit and publishes them with one store.
+  //Returns iterator to the first element which wasn't pushed.
+  template <typename InputIt>
+  InputIt tryPushRange(InputIt first, const InputIt last)
+  {
+    if (first == last)
+    {
+      return first;
+    }
+
+    //Head of consumer is loaded only when cached free slots aren't enough for the whole range.
+    //Length of single pass range is unknown, so one cached slot is enough for it.
+    using Category = typename std::iterator_traits<InputIt>::iterator_category;
+    std::size_t wanted{1};
+    if constexpr (std::is_base_of_v<std::forward_iterator_tag, Category>)
+    {
+      wanted = std::min(static_cast<std::size_t>(std::distance(first, last)), capacity());
+    }
+
+    std::size_t tail = producer_.position;
+    const std::size_t free_slots = freeSlots(wanted);
+
+    try
+    {
+      for (std::size_t i = 0; i < free_slots && first != last; ++i, ++first, ++tail)
+      {
+        ::new (static_cast<void*>(buffer_ + (tail & mask_))) T(*first);
+      }
+    }
+    catch (...)
+    {
+      publish(tail);
+      throw;
+    }
+
+    publish(tail);
+
+    return first;
+  }
+
+  //Consumer interface
+
+  bool try_pop(T& value) noexcept
+  {
+    static_assert(std::is_nothrow_move_assignable_v<T>, "move assignment of T must not throw");
+
+    return popData([&value](T& data) noexcept { value = std::move(data); });
+  }
+
+  std::optional<T> pop_value() noexcept
+  {
+    static_assert(std::is_nothrow_move_constructible_v<T>, "move constructor of T must not throw");
+
+    std::optional<T> value;
+    popData([&value](T& data) noexcept { value.emplace(std::move(data)); });
+
+    return value;
+  }
+
+  //Compatibility interface, boxes popped value into new allocation
+  std::unique_ptr<T> pop()
+  {
+    auto value = pop_value();
+
+    return value ? std::make_unique<T>(std::move(*value)) : nullptr;
+  }
+
+  //Ready elements up to the end of ring, consumer works with them in place
+  ReadSpan readSpan() noexcept
+  {
+    const std::size_t head = consumer_.position;
+    const std::size_t ready = readySlots();
+    const std::size_t till_end = capacity() - (head & mask_);
+
+    return ReadSpan{buffer_ + (head & mask_), std::min(ready, till_end)};
+  }
+
+  //Destroys first n elements of the last span and frees their slots with one store
+  void releaseSpan(const std::size_t n) noexcept
+  {
+    std::size_t head = consumer_.position;
+    for (std::size_t i = 0; i < n; ++i, ++head)
+    {
+      buffer_[head & mask_].~T();
+    }
+
+    consumer_.position = head;
+    head_.store(head, std::memory_order_release);
+  }
+
+  bool is_lock_free() const noexcept
+  {
+    return head_.is_lock_free() && tail_.is_lock_free();
+  }
+
+  ~Queue()
+  {
+    for (std::size_t pos = head_.load(std::memory_order_relaxed);
+         pos != tail_.load(std::memory_order_relaxed); ++pos)
+    {
+      buffer_[pos & mask_].~T();
+    }
+
+    std::allocator<T>{}.deallocate(buffer_, capacity());
+  }
+
+ private:
+  //Rereads position of consumer only when cached one doesn't give enough slots
+  std::size_t freeSlots(const std::size_t wanted) noexcept
+  {
+    std::size_t free_slots = capacity() - (producer_.position - producer_.cached_other_position);
+    if (free_slots < wanted)
+    {
+      producer_.cached_other_position = head_.load(std::memory_order_acquire);
+      free_slots = capacity() - (producer_.position - producer_.cached_other_position);
+    }
+
+    return free_slots;
+  }
+
+  std::size_t readySlots() noexcept
+  {
+    if (consumer_.position == consumer_.cached_other_position)
+    {
+      consumer_.cached_other_position = tail_.load(std::memory_order_acquire);
+    }
+
+    return consumer_.cached_other_position - consumer_.position;
+  }
+
+  template <typename... Args>
+  bool pushData(Args&&... args)
+  {
+    const std::size_t tail = producer_.position;
+    if (!freeSlots(1))
+    {
+      return false;
+    }
+
+    ::new (static_cast<void*>(buffer_ + (tail & mask_))) T(std::forward<Args>(args)...);
+    publish(tail + 1);
+
+    return true;
+  }
+
+  void publish(const std::size_t tail) noexcept
+  {
+    producer_.position = tail;
+    tail_.store(tail, std::memory_order_release);
+  }
+
+  template <typename Consumer>
+  bool popData(Consumer&& consume) noexcept
+  {
+    if (!readySlots())
+    {
+      return false;
+    }
+
+    const std::size_t head = consumer_.position;
+    T& value = buffer_[head & mask_];
+
+    consume(value);
+    value.~T();
+
+    consumer_.position = head + 1;
+    head_.store(head + 1, std::memory_order_release);
+
+    return true;
+  }
+};
+
+}
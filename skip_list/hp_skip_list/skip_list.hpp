@@ -0,0 +1,642 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <optional>
+#include <stdexcept>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <hp.hpp>
+
+namespace lock_free
+{
+
+//Lock-free skip list (Herlihy, Lev, Shavit). Marked next pointer at some level means that node
+//is being removed from that level, mark at the bottom level is the point where erase takes
+//effect. Every walk unlinks marked nodes it meets. Node is retired when it is unlinked from
+//every level it was linked to, so levels linked to the node are counted.
+template <typename Key, typename Value, typename Compare = std::less<Key>,
+          typename Allocator = std::allocator<std::pair<const Key, Value>>>
+class SkipList
+{
+  static_assert(std::is_nothrow_destructible_v<Key>, "destructor of Key must not throw");
+  static_assert(std::is_nothrow_destructible_v<Value>, "destructor of Value must not throw");
+
+  using stored_type = std::pair<const Key, Value>;
+
+  //Tower of next pointers lies right after node in the same allocation
+  struct Node final : hazard_pointers::Reclaimable<Node>
+  {
+    const std::size_t top_level;
+    //Levels where node is linked plus one while inserting thread still links it
+    std::atomic<std::size_t> links;
+    alignas(stored_type) std::byte storage[sizeof(stored_type)];
+
+    explicit Node(const std::size_t top_level) noexcept : top_level{top_level}, links{} {}
+
+    template <typename... Args>
+    explicit Node(const std::size_t top_level, Args&&... args) : top_level{top_level}, links{1}
+    {
+      ::new (static_cast<void*>(storage)) stored_type(std::forward<Args>(args)...);
+    }
+
+    stored_type& data() noexcept
+    {
+      return *std::launder(reinterpret_cast<stored_type*>(storage));
+    }
+
+    const Key& key() noexcept
+    {
+      return data().first;
+    }
+
+    std::atomic<Node*>* tower() noexcept
+    {
+      return std::launder(reinterpret_cast<std::atomic<Node*>*>(reinterpret_cast<std::byte*>(this) + sizeof(Node)));
+    }
+
+    std::atomic<Node*>& next(const std::size_t level) noexcept
+    {
+      return tower()[level];
+    }
+  };
+
+  struct alignas(Node) Block final
+  {
+    std::byte bytes[alignof(Node)];
+  };
+
+  using BlockAllocator = typename std::allocator_traits<Allocator>::template rebind_alloc<Block>;
+  using BlockAllocatorTraits = std::allocator_traits<BlockAllocator>;
+
+  static_assert(BlockAllocatorTraits::is_always_equal::value, "node allocator must be stateless");
+
+  static std::size_t blocksFor(const std::size_t top_level) noexcept
+  {
+    const std::size_t bytes = sizeof(Node) + (top_level + 1) * sizeof(std::atomic<Node*>);
+
+    return (bytes + sizeof(Block) - 1) / sizeof(Block);
+  }
+
+  template <typename... Args>
+  static Node* createNode(const std::size_t top_level, Args&&... args)
+  {
+    BlockAllocator allocator;
+    const std::size_t blocks = blocksFor(top_level);
+    Block* const memory = BlockAllocatorTraits::allocate(allocator, blocks);
+
+    Node* node;
+    try
+    {
+      node = ::new (static_cast<void*>(memory)) Node(top_level, std::forward<Args>(args)...);
+    }
+    catch (...)
+    {
+      BlockAllocatorTraits::deallocate(allocator, memory, blocks);
+      throw;
+    }
+
+    for (std::size_t level = 0; level <= top_level; ++level)
+    {
+      ::new (static_cast<void*>(node->tower() + level)) std::atomic<Node*>{nullptr};
+    }
+
+    return node;
+  }
+
+  static void releaseNode(Node* const node) noexcept
+  {
+    const std::size_t blocks = blocksFor(node->top_level);
+    node->~Node();
+
+    BlockAllocator allocator;
+    BlockAllocatorTraits::deallocate(allocator, reinterpret_cast<Block*>(node), blocks);
+  }
+
+  static void destroyNode(Node* const node) noexcept
+  {
+    node->data().~stored_type();
+    releaseNode(node);
+  }
+
+  template <typename P>
+  static bool isMarked(P* const p) noexcept
+  {
+    return reinterpret_cast<std::uintptr_t>(p) & 1;
+  }
+
+  template <typename P>
+  static P* marked(P* const p) noexcept
+  {
+    return reinterpret_cast<P*>(reinterpret_cast<std::uintptr_t>(p) | 1);
+  }
+
+  template <typename P>
+  static P* unmarked(P* const p) noexcept
+  {
+    return reinterpret_cast<P*>(reinterpret_cast<std::uintptr_t>(p) & ~std::uintptr_t{1});
+  }
+
+  static constexpr std::size_t max_level{24};
+  //Elements copied by one walk of iterator
+  static constexpr std::size_t batch_size{32};
+  static constexpr std::size_t cache_line_size{64};
+
+  //Each level is taken with probability 1/2
+  static std::size_t randomLevel() noexcept
+  {
+    thread_local std::uint64_t state = std::hash<std::thread::id>{}(std::this_thread::get_id()) | 1;
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+
+    std::size_t level{};
+    for (std::uint64_t bits = state; (bits & 1) && level < max_level; bits >>= 1, ++level);
+
+    return level;
+  }
+
+  hazard_pointers::HazardPointerDomain& domain_;
+  Node* const head_;
+  //Highest level which may have nodes, walks start there
+  alignas(cache_line_size) std::atomic<std::size_t> height_{};
+  alignas(cache_line_size) std::atomic<std::size_t> size_{};
+
+ public:
+  using value_type = std::pair<Key, Value>;
+
+  //Iterator copies elements in batches, so it holds no hazard pointers and stays valid while
+  //elements are erased. Next batch starts after the last key seen.
+  class const_iterator
+  {
+   public:
+    using iterator_category = std::input_iterator_tag;
+    using value_type = SkipList::value_type;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const value_type*;
+    using reference = const value_type&;
+
+   private:
+    SkipList* list_{};
+    std::vector<value_type> batch_;
+    std::size_t index_{};
+
+    friend class SkipList;
+
+    const_iterator(SkipList& list, std::vector<value_type> batch) noexcept
+      : list_{batch.empty() ? nullptr : &list}, batch_{std::move(batch)}
+    {}
+
+   public:
+    const_iterator() noexcept = default;
+
+    reference operator*() const noexcept
+    {
+      return batch_[index_];
+    }
+
+    pointer operator->() const noexcept
+    {
+      return &batch_[index_];
+    }
+
+    const_iterator& operator++()
+    {
+      if (++index_ == batch_.size())
+      {
+        std::vector<value_type> next_batch = list_->copyBatch(batch_.back().first, false);
+        *this = const_iterator{*list_, std::move(next_batch)};
+      }
+
+      return *this;
+    }
+
+    void operator++(int)
+    {
+      ++*this;
+    }
+
+    //Iterators over the same list are equal when they stand at the same key
+    bool operator==(const const_iterator& other) const noexcept
+    {
+      if (!list_ || !other.list_)
+      {
+        return list_ == other.list_;
+      }
+
+      const Key& key = batch_[index_].first;
+      const Key& other_key = other.batch_[other.index_].first;
+
+      return list_ == other.list_ && !Compare{}(key, other_key) && !Compare{}(other_key, key);
+    }
+
+    bool operator!=(const const_iterator& other) const noexcept
+    {
+      return !(*this == other);
+    }
+  };
+
+  SkipList() : SkipList{hazard_pointers::defaultDomain()} {}
+
+  //Walk holds two hazard pointers: predecessor and current node
+  explicit SkipList(hazard_pointers::HazardPointerDomain& domain)
+    : domain_{domain}, head_{createNode(max_level)}
+  {
+    if (domain_.slotsPerThread() < 2)
+    {
+      releaseNode(head_);
+      throw std::invalid_argument{"skip list needs two hazard pointers per thread"};
+    }
+  }
+
+  SkipList(const SkipList&) = delete;
+  SkipList& operator=(const SkipList&) = delete;
+
+  //Returns copy of value, because element may be erased right after return
+  std::optional<Value> find(const Key& key)
+  {
+    const Position position = search(key, 0);
+    if (!isEqual(position.curr, key))
+    {
+      hazard_pointers::clearHazardPointers(domain_);
+      return std::nullopt;
+    }
+
+    try
+    {
+      std::optional<Value> value{position.curr->data().second};
+      hazard_pointers::clearHazardPointers(domain_);
+
+      return value;
+    }
+    catch (...)
+    {
+      hazard_pointers::clearHazardPointers(domain_);
+      throw;
+    }
+  }
+
+  bool contains(const Key& key)
+  {
+    const bool found = isEqual(search(key, 0).curr, key);
+    hazard_pointers::clearHazardPointers(domain_);
+
+    return found;
+  }
+
+  //Returns false and leaves list untouched when key is already there
+  bool insert(const Key& key, const Value& value)
+  {
+    return insertData(key, value);
+  }
+
+  bool insert(const Key& key, Value&& value)
+  {
+    return insertData(key, std::move(value));
+  }
+
+  bool erase(const Key& key)
+  {
+    const Position position = search(key, 0);
+    Node* const node = position.curr;
+    if (!isEqual(node, key))
+    {
+      hazard_pointers::clearHazardPointers(domain_);
+      return false;
+    }
+
+    for (std::size_t level = node->top_level; level > 0; --level)
+    {
+      markNext(*node, level);
+    }
+
+    //Only one thread marks the bottom level
+    Node* next = node->next(0).load();
+    for (;;)
+    {
+      if (isMarked(next))
+      {
+        hazard_pointers::clearHazardPointers(domain_);
+        return false;
+      }
+
+      if (node->next(0).compare_exchange_weak(next, marked(next)))
+      {
+        break;
+      }
+    }
+    size_.fetch_sub(1, std::memory_order_relaxed);
+
+    //Walk to the key unlinks node from every level
+    search(key, 0);
+    hazard_pointers::reclaimIfPossible(domain_);
+
+    return true;
+  }
+
+  const_iterator begin()
+  {
+    return const_iterator{*this, copyBatch(std::nullopt, true)};
+  }
+
+  const_iterator end() noexcept
+  {
+    return const_iterator{};
+  }
+
+  //The first element which is not less than key
+  const_iterator lower_bound(const Key& key)
+  {
+    return const_iterator{*this, copyBatch(key, true)};
+  }
+
+  //The first element which is greater than key
+  const_iterator upper_bound(const Key& key)
+  {
+    return const_iterator{*this, copyBatch(key, false)};
+  }
+
+  //Exact only when list is not modified concurrently
+  std::size_t size() const noexcept
+  {
+    return size_.load(std::memory_order_relaxed);
+  }
+
+  bool empty() const noexcept
+  {
+    return !size();
+  }
+
+  bool is_lock_free() const noexcept
+  {
+    return head_->next(0).is_lock_free() && head_->links.is_lock_free();
+  }
+
+  ~SkipList()
+  {
+    for (Node* node = unmarked(head_->next(0).load(std::memory_order_acquire)); node;)
+    {
+      Node* const next = unmarked(node->next(0).load(std::memory_order_relaxed));
+      destroyNode(node);
+      node = next;
+    }
+
+    releaseNode(head_);
+  }
+
+ private:
+  //Predecessor and current node of walk at some level, both are protected
+  struct Position
+  {
+    Node* pred;
+    Node* curr;
+    std::size_t pred_slot;
+    std::size_t curr_slot;
+  };
+
+  bool isEqual(Node* const node, const Key& key) noexcept
+  {
+    return node && !Compare{}(key, node->key());
+  }
+
+  void markNext(Node& node, const std::size_t level) noexcept
+  {
+    Node* next = node.next(level).load();
+    while (!isMarked(next) && !node.next(level).compare_exchange_weak(next, marked(next)));
+  }
+
+  void unlinked(Node* const node) noexcept
+  {
+    if (node->links.fetch_sub(1, std::memory_order_acq_rel) == 1)
+    {
+      hazard_pointers::addToReclaimList(domain_, node, &destroyNode);
+    }
+  }
+
+  //Moves position along its level while goes_after(curr) is true, unlinks marked nodes.
+  //Fails when predecessor is changed or removed, then walk has to start from head.
+  template <typename Predicate>
+  bool tryToMove(Position& position, const std::size_t level, Predicate&& goes_after)
+  {
+    for (;;)
+    {
+      Node* const curr = position.curr;
+      if (isMarked(curr))
+      {
+        return false;
+      }
+
+      if (!curr)
+      {
+        return true;
+      }
+
+      hazard_pointers::publish(domain_, position.curr_slot, curr);
+      if (position.pred->next(level).load() != curr)
+      {
+        return false;
+      }
+
+      Node* const next = curr->next(level).load();
+      if (isMarked(next))
+      {
+        Node* expected = curr;
+        if (!position.pred->next(level).compare_exchange_strong(expected, unmarked(next)))
+        {
+          return false;
+        }
+
+        unlinked(curr);
+        position.curr = unmarked(next);
+        continue;
+      }
+
+      if (!goes_after(*curr))
+      {
+        return true;
+      }
+
+      position.pred = curr;
+      std::swap(position.pred_slot, position.curr_slot);
+      position.curr = next;
+    }
+  }
+
+  //Descends from the top to bottom level and stops before the first node which doesn't go
+  //after the bound. Bound is excluded only if inclusive is false, null bound means head.
+  Position search(const Key* const bound, const bool inclusive, const std::size_t bottom) noexcept
+  {
+    const auto goes_after = [bound, inclusive](Node& node) noexcept {
+      return bound && (inclusive ? Compare{}(node.key(), *bound) : !Compare{}(*bound, node.key()));
+    };
+
+    for (;;)
+    {
+      std::size_t level = std::max(height_.load(std::memory_order_relaxed), bottom);
+      Position position{head_, head_->next(level).load(), 1, 0};
+
+      bool moved;
+      for (;;)
+      {
+        moved = tryToMove(position, level, goes_after);
+        if (!moved || level == bottom)
+        {
+          break;
+        }
+
+        --level;
+        position.curr = position.pred->next(level).load();
+      }
+
+      if (moved)
+      {
+        return position;
+      }
+    }
+  }
+
+  Position search(const Key& key, const std::size_t bottom) noexcept
+  {
+    return search(&key, true, bottom);
+  }
+
+  template <typename V>
+  bool insertData(const Key& key, V&& value)
+  {
+    const std::size_t top_level = randomLevel();
+
+    Node* node{};
+    for (;;)
+    {
+      const Position position = search(key, 0);
+      if (isEqual(position.curr, key))
+      {
+        hazard_pointers::clearHazardPointers(domain_);
+        if (node)
+        {
+          destroyNode(node);
+        }
+        return false;
+      }
+
+      if (!node)
+      {
+        try
+        {
+          node = createNode(top_level, key, std::forward<V>(value));
+        }
+        catch (...)
+        {
+          hazard_pointers::clearHazardPointers(domain_);
+          throw;
+        }
+        raiseHeight(top_level);
+      }
+
+      node->next(0).store(position.curr, std::memory_order_relaxed);
+      node->links.store(2, std::memory_order_relaxed);
+
+      Node* expected = position.curr;
+      if (position.pred->next(0).compare_exchange_strong(expected, node))
+      {
+        break;
+      }
+    }
+    size_.fetch_add(1, std::memory_order_relaxed);
+
+    linkUpperLevels(*node, key);
+
+    //Late link could be done after erase has walked through the list
+    if (isMarked(node->next(0).load()))
+    {
+      search(key, 0);
+    }
+    unlinked(node);
+    hazard_pointers::reclaimIfPossible(domain_);
+
+    return true;
+  }
+
+  //Stops as soon as node is marked, such levels are never linked and never counted
+  void linkUpperLevels(Node& node, const Key& key) noexcept
+  {
+    for (std::size_t level = 1; level <= node.top_level; ++level)
+    {
+      for (;;)
+      {
+        const Position position = search(key, level);
+
+        Node* next = node.next(level).load();
+        if (isMarked(next) || !node.next(level).compare_exchange_strong(next, position.curr))
+        {
+          return;
+        }
+
+        node.links.fetch_add(1, std::memory_order_relaxed);
+        Node* expected = position.curr;
+        if (position.pred->next(level).compare_exchange_strong(expected, &node))
+        {
+          break;
+        }
+        node.links.fetch_sub(1, std::memory_order_relaxed);
+      }
+    }
+  }
+
+  void raiseHeight(const std::size_t level) noexcept
+  {
+    std::size_t height = height_.load(std::memory_order_relaxed);
+    while (height < level && !height_.compare_exchange_weak(height, level, std::memory_order_relaxed));
+  }
+
+  //Copies elements starting from the bound while they are protected one by one
+  std::vector<value_type> copyBatch(std::optional<Key> bound, bool inclusive)
+  {
+    std::vector<value_type> batch;
+    batch.reserve(batch_size);
+
+    try
+    {
+      for (;;)
+      {
+        Position position = search(bound ? &*bound : nullptr, inclusive, 0);
+
+        const auto copy = [&batch](Node& node) {
+          batch.emplace_back(node.data().first, node.data().second);
+          return batch.size() < batch_size;
+        };
+
+        if (tryToMove(position, 0, copy))
+        {
+          break;
+        }
+
+        //Walk is started again after the last copied key
+        if (!batch.empty())
+        {
+          bound = batch.back().first;
+          inclusive = false;
+        }
+      }
+    }
+    catch (...)
+    {
+      hazard_pointers::clearHazardPointers(domain_);
+      throw;
+    }
+    hazard_pointers::clearHazardPointers(domain_);
+
+    return batch;
+  }
+};
+
+}
@@ -1,13 +1,21 @@
 #pragma once
 
+#include <algorithm>
 #include <atomic>
+#include <cstddef>
 #include <memory>
+#include <new>
+#include <optional>
+#include <stdexcept>
 #include <type_traits>
+#include <vector>
+
+#include <contention.hpp>
 
 namespace lock_free
 {
 
-template <typename T>
+template <typename T, typename Allocator = std::allocator<T>, typename Counting = contention::Mode>
 class Stack
 {
   struct Node;
@@ -23,27 +31,72 @@ class Stack
     }
     static NodePtr CreateNodePtr(T&& data)
     {
-      return CreateNodePtr(new Node{std::make_unique<T>(std::move(data))});
+      return CreateNodePtr(createNode(std::move(data)));
     }
     static NodePtr CreateNodePtr(const T& data) 
     {
-      return CreateNodePtr(new Node{std::make_unique<T>(data)});
+      return CreateNodePtr(createNode(data));
     }
     static NodePtr CreateNodePtr(std::unique_ptr<T> data)
     {
-      return CreateNodePtr(new Node{std::move(data)});
+      return CreateNodePtr(createNode(std::move(*data)));
     }
   };
 
+  //Value lives inside of node while node is in the list and is destroyed right after pop
   struct Node final
   {
-    std::unique_ptr<T> data;
-    std::atomic<int> internal_counter;
-    NodePtr next;
+    alignas(T) std::byte storage[sizeof(T)];
+    std::atomic<int> internal_counter{};
+    NodePtr next{};
 
-    Node(std::unique_ptr<T> ptr) noexcept : data{std::move(ptr)}, internal_counter{}, next{} {}
+    template <typename... Args>
+    explicit Node(Args&&... args)
+    {
+      ::new (static_cast<void*>(storage)) T(std::forward<Args>(args)...);
+    }
+
+    T& value() noexcept
+    {
+      return *std::launder(reinterpret_cast<T*>(storage));
+    }
+
+    void destroyValue() noexcept
+    {
+      value().~T();
+    }
   };
 
+  using NodeAllocator = typename std::allocator_traits<Allocator>::template rebind_alloc<Node>;
+  using NodeAllocatorTraits = std::allocator_traits<NodeAllocator>;
+
+  static_assert(NodeAllocatorTraits::is_always_equal::value, "node allocator must be stateless");
+
+  template <typename... Args>
+  static Node* createNode(Args&&... args)
+  {
+    NodeAllocator allocator;
+    Node* const node = NodeAllocatorTraits::allocate(allocator, 1);
+    try
+    {
+      NodeAllocatorTraits::construct(allocator, node, std::forward<Args>(args)...);
+    }
+    catch (...)
+    {
+      NodeAllocatorTraits::deallocate(allocator, node, 1);
+      throw;
+    }
+
+    return node;
+  }
+
+  static void destroyNode(Node* const node) noexcept
+  {
+    NodeAllocator allocator;
+    NodeAllocatorTraits::destroy(allocator, node);
+    NodeAllocatorTraits::deallocate(allocator, node, 1);
+  }
+
   std::atomic<NodePtr> head_{};
 
  public:
@@ -59,11 +112,189 @@ class Stack
 
   void pushReadyData(std::unique_ptr<T> data)
   {
+    if (!data)
+    {
+      throw std::invalid_argument{"null value can't be pushed"};
+    }
+
     pushNode(NodePtr::CreateNodePtr(std::move(data)));
   }
 
-  std::unique_ptr<T> pop() noexcept
+  //Links nodes privately and publishes them with one CAS, last element ends up on top
+  template <typename InputIt>
+  void pushRange(InputIt first, const InputIt last)
+  {
+    NodePtr chain_first{};
+    Node* chain_last{};
+
+    try
+    {
+      for (; first != last; ++first)
+      {
+        const NodePtr node_ptr = NodePtr::CreateNodePtr(createNode(*first));
+        node_ptr.node->next = chain_first;
+        chain_first = node_ptr;
+        chain_last = chain_last ? chain_last : node_ptr.node;
+      }
+    }
+    catch (...)
+    {
+      for (Node* node = chain_first.node; node;)
+      {
+        Node* const next = node->next.node;
+        node->destroyValue();
+        destroyNode(node);
+        node = next;
+      }
+      throw;
+    }
+
+    if (chain_last)
+    {
+      pushChain(chain_first, chain_last);
+    }
+  }
+
+  bool try_pop(T& value) noexcept
+  {
+    static_assert(std::is_nothrow_move_assignable_v<T>, "move assignment of T must not throw");
+
+    return popData([&value](T& data) noexcept { value = std::move(data); });
+  }
+
+  std::optional<T> pop_value() noexcept
+  {
+    static_assert(std::is_nothrow_move_constructible_v<T>, "move constructor of T must not throw");
+
+    std::optional<T> value;
+    popData([&value](T& data) noexcept { value.emplace(std::move(data)); });
+
+    return value;
+  }
+
+  //Compatibility interface, boxes popped value into new allocation
+  std::unique_ptr<T> pop()
+  {
+    auto value = pop_value();
+
+    return value ? std::make_unique<T>(std::move(*value)) : nullptr;
+  }
+
+  //Detaches the whole list with one exchange, values are returned in pop order
+  std::vector<T> popAll()
+  {
+    static_assert(std::is_nothrow_move_constructible_v<T>, "move constructor of T must not throw");
+
+    const NodePtr first = head_.exchange(NodePtr{}, std::memory_order_acquire);
+
+    std::size_t count{};
+    Node* last{};
+    for (Node* node = first.node; node; last = node, node = node->next.node, ++count);
+
+    std::vector<T> values;
+    try
+    {
+      values.reserve(count);
+    }
+    catch (...)
+    {
+      if (last)
+      {
+        pushChain(first, last);
+      }
+      throw;
+    }
+
+    //External counter of each node keeps reference of the list and references of threads
+    //which have incremented it while the node was head
+    for (NodePtr node_ptr = first; node_ptr.node;)
+    {
+      Node* const node = node_ptr.node;
+      const NodePtr next = node->next;
+
+      values.push_back(std::move(node->value()));
+      node->destroyValue();
+
+      const int external_count = node_ptr.external_counter - 1;
+      if (node->internal_counter.fetch_add(external_count, std::memory_order_release) == 
+          -external_count)
+      {
+        destroyNode(node);
+      }
+
+      node_ptr = next;
+    }
+
+    return values;
+  }
+
+  //Only head node is protected by counters, so up to n nodes are detached one by one
+  std::vector<T> popN(const std::size_t n)
   {
+    static_assert(std::is_nothrow_move_constructible_v<T>, "move constructor of T must not throw");
+
+    std::vector<T> values;
+
+    //Vector grows before each pop, so n much bigger than the stack isn't reserved
+    //and popped value always has a place
+    while (values.size() < n)
+    {
+      if (values.size() == values.capacity() && !growValues(values, n))
+      {
+        break;
+      }
+
+      if (!popData([&values](T& data) noexcept { values.push_back(std::move(data)); }))
+      {
+        break;
+      }
+    }
+
+    return values;
+  }
+
+  bool is_lock_free() const noexcept
+  {
+    return head_.is_lock_free();
+  }
+
+  ~Stack()
+  {
+    for (auto head_node_ptr = head_.load(std::memory_order_acquire).node; head_node_ptr;)
+    {
+      const auto next = head_node_ptr->next;
+      head_node_ptr->destroyValue();
+      destroyNode(head_node_ptr);
+      head_node_ptr = next.node;
+    }
+  }
+
+ private:
+  //Doubles capacity up to n. Returns false if values are already popped and vector can't grow,
+  //then caller returns them instead of losing them.
+  static bool growValues(std::vector<T>& values, const std::size_t n)
+  {
+    try
+    {
+      values.reserve(std::min(n, std::max<std::size_t>(2 * values.capacity(), 16)));
+    }
+    catch (...)
+    {
+      if (values.empty())
+      {
+        throw;
+      }
+      return false;
+    }
+
+    return true;
+  }
+
+  template <typename Consumer>
+  bool popData(Consumer&& consume) noexcept
+  {
+    static_assert(std::is_nothrow_destructible_v<T>, "destructor of T must not throw");
+
     NodePtr old_head = head_.load(std::memory_order_relaxed);
     for (;;)
     {
@@ -71,70 +302,68 @@ class Stack
 
       if (!old_head.node)
       {
-        return {};
+        contention::count(contention::Event::empty_pop);
+        return false;
       }
 
       Node* const node = old_head.node;
 
-      if (head_.compare_exchange_strong(old_head, node->next, std::memory_order_relaxed))
+      if (contention::cas(head_.compare_exchange_strong(old_head, node->next, std::memory_order_relaxed)))
       {
-        std::unique_ptr data = std::move(node->data);
+        consume(node->value());
+        node->destroyValue();
 
 	const int external_count = old_head.external_counter - 2;
 	if (node->internal_counter.fetch_add(external_count, 
                                              std::memory_order_release) == 
             -external_count)
 	{
-          delete node;
+          destroyNode(node);
         }
         
-        return data;
+        return true;
       }
 
       if (node->internal_counter.fetch_sub(1, std::memory_order_relaxed) == 1)
       {
         node->internal_counter.load(std::memory_order_acquire);
-        delete node;
+        destroyNode(node);
       }
     }
   }
 
-  bool is_lock_free() const noexcept
-  {
-    return head_.is_lock_free();
-  }
-
-  ~Stack()
+  void pushNode(const NodePtr node_ptr) noexcept
   {
-    for (auto head_node_ptr = head_.load(std::memory_order_acquire).node; head_node_ptr;)
-    {
-      const auto next = head_node_ptr->next;
-      delete head_node_ptr;
-      head_node_ptr = next.node;
-    }
+    pushChain(node_ptr, node_ptr.node);
   }
 
- private:
-  void pushNode(NodePtr node_ptr) noexcept
+  void pushChain(const NodePtr first, Node* const last) noexcept
   {
-    node_ptr.node->next = head_.load(std::memory_order_relaxed);
+    last->next = head_.load(std::memory_order_relaxed);
 
-    while (!head_.compare_exchange_weak(node_ptr.node->next, node_ptr, 
-                                        std::memory_order_release, 
-                                        std::memory_order_relaxed));
+    while (!contention::cas(head_.compare_exchange_weak(last->next, first,
+                                                        std::memory_order_release,
+                                                        std::memory_order_relaxed)));
   }
 
+  //Failed increment is counted as validation retry, it plays the role of hazard pointer check
   void incrementHeadCounter(NodePtr& old_head) noexcept
   {
     NodePtr tmp;
-    do
+    for (;;)
     {
       tmp = old_head;
       ++tmp.external_counter;
+
+      if (head_.compare_exchange_weak(old_head, tmp,
+                                      std::memory_order_acquire,
+                                      std::memory_order_relaxed))
+      {
+        break;
+      }
+
+      contention::count(contention::Event::validation_retry);
     }
-    while (!head_.compare_exchange_weak(old_head, tmp, 
-                                        std::memory_order_acquire, 
-                                        std::memory_order_relaxed));
 
     ++old_head.external_counter;
   }
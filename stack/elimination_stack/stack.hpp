@@ -0,0 +1,290 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <new>
+#include <optional>
+#include <stdexcept>
+#include <thread>
+#include <type_traits>
+
+#include <contention.hpp>
+
+#include <hp.hpp>
+
+namespace lock_free
+{
+
+//Hazard pointer stack with elimination backoff: push and pop that failed CAS on head_
+//try to meet in elimination array and exchange node directly without touching head_.
+template <typename T, typename Allocator = std::allocator<T>, typename Counting = contention::Mode>
+class Stack
+{
+  //Value lives inside of node while node is in the list and is destroyed right after pop.
+  //Retired node is linked into reclaim list by itself, so pop doesn't allocate.
+  struct Node final : hazard_pointers::Reclaimable<Node>
+  {
+    alignas(T) std::byte storage[sizeof(T)];
+    Node* next{};
+
+    Node() noexcept = default;
+
+    template <typename... Args>
+    explicit Node(Args&&... args)
+    {
+      ::new (static_cast<void*>(storage)) T(std::forward<Args>(args)...);
+    }
+
+    T& value() noexcept
+    {
+      return *std::launder(reinterpret_cast<T*>(storage));
+    }
+
+    void destroyValue() noexcept
+    {
+      value().~T();
+    }
+  };
+
+  using NodeAllocator = typename std::allocator_traits<Allocator>::template rebind_alloc<Node>;
+  using NodeAllocatorTraits = std::allocator_traits<NodeAllocator>;
+
+  static_assert(NodeAllocatorTraits::is_always_equal::value, "node allocator must be stateless");
+
+  template <typename... Args>
+  static Node* createNode(Args&&... args)
+  {
+    NodeAllocator allocator;
+    Node* const node = NodeAllocatorTraits::allocate(allocator, 1);
+    try
+    {
+      NodeAllocatorTraits::construct(allocator, node, std::forward<Args>(args)...);
+    }
+    catch (...)
+    {
+      NodeAllocatorTraits::deallocate(allocator, node, 1);
+      throw;
+    }
+
+    return node;
+  }
+
+  static void destroyNode(Node* const node) noexcept
+  {
+    NodeAllocator allocator;
+    NodeAllocatorTraits::destroy(allocator, node);
+    NodeAllocatorTraits::deallocate(allocator, node, 1);
+  }
+
+  static constexpr std::size_t cache_line_size{64};
+  static constexpr std::size_t elimination_array_size{8};
+  static constexpr int elimination_spins{256};
+
+  struct alignas(cache_line_size) EliminationSlot final
+  {
+    std::atomic<Node*> node{};
+  };
+
+  //Is put to slot by pop which took pushed node. Only pusher resets slot back to nullptr.
+  //Never holds value.
+  inline static Node taken_marker_{};
+
+  hazard_pointers::HazardPointerDomain& domain_;
+  alignas(cache_line_size) std::atomic<Node*> head_{};
+  EliminationSlot elimination_[elimination_array_size];
+
+ public:
+  //First use of default domain allocates its state
+  Stack() : domain_{hazard_pointers::defaultDomain()} {}
+
+  //Stacks with own domain don't scan hazard pointers of each other
+  explicit Stack(hazard_pointers::HazardPointerDomain& domain) noexcept : domain_{domain} {}
+
+  Stack(const Stack&) = delete;
+  Stack& operator=(const Stack&) = delete;
+
+  void push(T&& data)
+  {
+    pushNode(createNode(std::move(data)));
+  }
+
+  void push(const T& data)
+  {
+    pushNode(createNode(data));
+  }
+
+  void pushReadyData(std::unique_ptr<T> data)
+  {
+    if (!data)
+    {
+      throw std::invalid_argument{"null value can't be pushed"};
+    }
+
+    pushNode(createNode(std::move(*data)));
+  }
+
+  bool try_pop(T& value) noexcept
+  {
+    static_assert(std::is_nothrow_move_assignable_v<T>, "move assignment of T must not throw");
+
+    return popData([&value](T& data) noexcept { value = std::move(data); });
+  }
+
+  std::optional<T> pop_value() noexcept
+  {
+    static_assert(std::is_nothrow_move_constructible_v<T>, "move constructor of T must not throw");
+
+    std::optional<T> value;
+    popData([&value](T& data) noexcept { value.emplace(std::move(data)); });
+
+    return value;
+  }
+
+  //Compatibility interface, boxes popped value into new allocation
+  std::unique_ptr<T> pop()
+  {
+    auto value = pop_value();
+
+    return value ? std::make_unique<T>(std::move(*value)) : nullptr;
+  }
+
+  bool is_lock_free() const noexcept
+  {
+    return head_.is_lock_free();
+  }
+
+  ~Stack()
+  {
+    for (auto ptr = head_.load(std::memory_order_acquire); ptr;)
+    {
+      const auto next = ptr->next;
+      ptr->destroyValue();
+      destroyNode(ptr);
+      ptr = next;
+    }
+  }
+
+ private:
+  template <typename Consumer>
+  bool popData(Consumer&& consume) noexcept
+  {
+    static_assert(std::is_nothrow_destructible_v<T>, "destructor of T must not throw");
+
+    Node* old_head;
+
+    for (;;)
+    {
+      old_head = hazard_pointers::protect(domain_, 0, head_);
+
+      if (!old_head || contention::cas(head_.compare_exchange_strong(old_head, old_head->next,
+                                                                     std::memory_order_acquire,
+                                                                     std::memory_order_relaxed)))
+      {
+        break;
+      }
+
+      if (Node* const node = tryEliminatePop())
+      {
+        //Node has never been in the list, so nobody else can reference it
+        hazard_pointers::clearHazardPointers(domain_);
+
+        consume(node->value());
+        node->destroyValue();
+        destroyNode(node);
+
+        return true;
+      }
+    }
+
+    if (!old_head)
+    {
+      hazard_pointers::clearHazardPointers(domain_);
+      contention::count(contention::Event::empty_pop);
+      return false;
+    }
+
+    consume(old_head->value());
+    old_head->destroyValue();
+
+    hazard_pointers::addToReclaimList(domain_, old_head, &destroyNode);
+    hazard_pointers::reclaimIfPossible(domain_);
+
+    return true;
+  }
+
+  void pushNode(Node* const node) noexcept
+  {
+    node->next = head_.load(std::memory_order_relaxed);
+
+    while (!contention::cas(head_.compare_exchange_weak(node->next, node,
+                                                        std::memory_order_release,
+                                                        std::memory_order_relaxed)))
+    {
+      if (tryEliminatePush(node))
+      {
+        return;
+      }
+    }
+  }
+
+  bool tryEliminatePush(Node* const node) noexcept
+  {
+    std::atomic<Node*>& slot = randomSlot();
+
+    Node* expected{};
+    if (!slot.compare_exchange_strong(expected, node,
+                                      std::memory_order_release,
+                                      std::memory_order_relaxed))
+    {
+      return false;
+    }
+
+    for (int i = 0; i < elimination_spins && slot.load(std::memory_order_relaxed) == node; ++i);
+
+    expected = node;
+    if (slot.compare_exchange_strong(expected, nullptr,
+                                     std::memory_order_relaxed,
+                                     std::memory_order_relaxed))
+    {
+      return false;
+    }
+
+    //Pop has taken the node and left marker
+    slot.store(nullptr, std::memory_order_relaxed);
+
+    return true;
+  }
+
+  Node* tryEliminatePop() noexcept
+  {
+    std::atomic<Node*>& slot = randomSlot();
+
+    for (int i = 0; i < elimination_spins; ++i)
+    {
+      Node* node = slot.load(std::memory_order_relaxed);
+
+      if (node && node != &taken_marker_ &&
+          slot.compare_exchange_strong(node, &taken_marker_,
+                                       std::memory_order_acquire,
+                                       std::memory_order_relaxed))
+      {
+        return node;
+      }
+    }
+
+    return nullptr;
+  }
+
+  std::atomic<Node*>& randomSlot() noexcept
+  {
+    static thread_local std::size_t seed{std::hash<std::thread::id>{}(std::this_thread::get_id())};
+
+    seed = seed * 6364136223846793005ull + 1442695040888963407ull;
+
+    return elimination_[(seed >> 33) % elimination_array_size].node;
+  }
+};
+
+}
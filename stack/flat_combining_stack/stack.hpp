@@ -0,0 +1,320 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <optional>
+#include <stdexcept>
+#include <thread>
+#include <type_traits>
+
+namespace lock_free
+{
+
+//Flat combining stack: threads publish requests in slots of publication array and one of them,
+//the combiner, applies all pending requests under the lock in one pass. Push and pop of the same
+//pass cancel each other without touching the list, so the list is touched by one thread at a time.
+template <typename T, typename Allocator = std::allocator<T>>
+class Stack
+{
+  //Value lives inside of node while node is in the list and is destroyed right after pop
+  struct Node final
+  {
+    Node* next;
+    alignas(T) std::byte storage[sizeof(T)];
+
+    template <typename... Args>
+    explicit Node(Args&&... args)
+    {
+      ::new (static_cast<void*>(storage)) T(std::forward<Args>(args)...);
+    }
+
+    T& value() noexcept
+    {
+      return *std::launder(reinterpret_cast<T*>(storage));
+    }
+
+    void destroyValue() noexcept
+    {
+      value().~T();
+    }
+  };
+
+  using NodeAllocator = typename std::allocator_traits<Allocator>::template rebind_alloc<Node>;
+  using NodeAllocatorTraits = std::allocator_traits<NodeAllocator>;
+
+  static_assert(NodeAllocatorTraits::is_always_equal::value, "node allocator must be stateless");
+
+  template <typename... Args>
+  static Node* createNode(Args&&... args)
+  {
+    NodeAllocator allocator;
+    Node* const node = NodeAllocatorTraits::allocate(allocator, 1);
+    try
+    {
+      NodeAllocatorTraits::construct(allocator, node, std::forward<Args>(args)...);
+    }
+    catch (...)
+    {
+      NodeAllocatorTraits::deallocate(allocator, node, 1);
+      throw;
+    }
+
+    return node;
+  }
+
+  static void destroyNode(Node* const node) noexcept
+  {
+    NodeAllocator allocator;
+    NodeAllocatorTraits::destroy(allocator, node);
+    NodeAllocatorTraits::deallocate(allocator, node, 1);
+  }
+
+  static constexpr std::size_t cache_line_size{64};
+  static constexpr std::size_t num_of_slots{64};
+  static constexpr int spins_before_yield{128};
+
+  enum class State : unsigned char
+  {
+    free,
+    //Owner is writing request
+    claimed,
+    push,
+    pop,
+    //Combiner has applied request, node of pop is the result
+    done,
+  };
+
+  //Slot is taken for one operation only, so it doesn't belong to any thread
+  struct alignas(cache_line_size) Request final
+  {
+    std::atomic<State> state{State::free};
+    Node* node{};
+  };
+
+  alignas(cache_line_size) std::atomic<bool> locked_{};
+  //Slots are taken from the beginning, combiner doesn't look further
+  std::atomic<std::size_t> used_slots_{};
+  Node* head_{};
+  Request requests_[num_of_slots];
+
+  //Threads start search from different slots, so usually every thread has its own slot
+  static std::size_t homeSlot() noexcept
+  {
+    static std::atomic<std::size_t> next_home{};
+    static thread_local const std::size_t home = next_home.fetch_add(1, std::memory_order_relaxed) % num_of_slots;
+
+    return home;
+  }
+
+  Request& claimSlot() noexcept
+  {
+    for (std::size_t i = homeSlot();; i = (i + 1) % num_of_slots)
+    {
+      Request& request = requests_[i];
+
+      State expected = State::free;
+      if (request.state.load(std::memory_order_relaxed) == State::free &&
+          request.state.compare_exchange_strong(expected, State::claimed, std::memory_order_acquire,
+                                                std::memory_order_relaxed))
+      {
+        for (std::size_t used = used_slots_.load(std::memory_order_relaxed);
+             used <= i && !used_slots_.compare_exchange_weak(used, i + 1, std::memory_order_release,
+                                                             std::memory_order_relaxed););
+        return request;
+      }
+
+      if (i + 1 == num_of_slots)
+      {
+        std::this_thread::yield();
+      }
+    }
+  }
+
+  bool tryLock() noexcept
+  {
+    return !locked_.load(std::memory_order_relaxed) && !locked_.exchange(true, std::memory_order_acquire);
+  }
+
+  void unlock() noexcept
+  {
+    locked_.store(false, std::memory_order_release);
+  }
+
+  static void complete(Request& request) noexcept
+  {
+    request.state.store(State::done, std::memory_order_release);
+  }
+
+  //Only under the lock
+  void combine() noexcept
+  {
+    Request* pushes[num_of_slots];
+    Request* pops[num_of_slots];
+    std::size_t num_of_pushes{};
+    std::size_t num_of_pops{};
+
+    const std::size_t used = used_slots_.load(std::memory_order_acquire);
+    for (std::size_t i = 0; i < used; ++i)
+    {
+      const State state = requests_[i].state.load(std::memory_order_acquire);
+      if (state == State::push)
+      {
+        pushes[num_of_pushes++] = &requests_[i];
+      }
+      else if (state == State::pop)
+      {
+        pops[num_of_pops++] = &requests_[i];
+      }
+    }
+
+    //Push immediately followed by pop leaves the list as it was
+    for (; num_of_pushes && num_of_pops; --num_of_pushes, --num_of_pops)
+    {
+      pops[num_of_pops - 1]->node = pushes[num_of_pushes - 1]->node;
+      complete(*pushes[num_of_pushes - 1]);
+      complete(*pops[num_of_pops - 1]);
+    }
+
+    for (std::size_t i = 0; i < num_of_pushes; ++i)
+    {
+      pushes[i]->node->next = head_;
+      head_ = pushes[i]->node;
+      complete(*pushes[i]);
+    }
+
+    for (std::size_t i = 0; i < num_of_pops; ++i)
+    {
+      pops[i]->node = head_;
+      if (head_)
+      {
+        head_ = head_->next;
+      }
+      complete(*pops[i]);
+    }
+  }
+
+  //Returns node of pop, request is free after that
+  Node* apply(const State operation, Node* const node) noexcept
+  {
+    Request& request = claimSlot();
+    request.node = node;
+    request.state.store(operation, std::memory_order_release);
+
+    for (int spins = 0; request.state.load(std::memory_order_acquire) != State::done;)
+    {
+      if (tryLock())
+      {
+        combine();
+        unlock();
+        continue;
+      }
+
+      if (++spins == spins_before_yield)
+      {
+        spins = 0;
+        std::this_thread::yield();
+      }
+    }
+
+    Node* const result = request.node;
+    request.state.store(State::free, std::memory_order_release);
+
+    return result;
+  }
+
+  void pushNode(Node* const node) noexcept
+  {
+    apply(State::push, node);
+  }
+
+ public:
+  Stack() = default;
+  Stack(const Stack&) = delete;
+  Stack& operator=(const Stack&) = delete;
+
+  void push(const T& data)
+  {
+    pushNode(createNode(data));
+  }
+
+  void push(T&& data)
+  {
+    pushNode(createNode(std::move(data)));
+  }
+
+  void pushReadyData(std::unique_ptr<T> data)
+  {
+    if (!data)
+    {
+      throw std::invalid_argument{"null value can't be pushed"};
+    }
+
+    pushNode(createNode(std::move(*data)));
+  }
+
+  bool try_pop(T& value) noexcept
+  {
+    static_assert(std::is_nothrow_move_assignable_v<T>, "move assignment of T must not throw");
+
+    return popData([&value](T& data) noexcept { value = std::move(data); });
+  }
+
+  std::optional<T> pop_value() noexcept
+  {
+    static_assert(std::is_nothrow_move_constructible_v<T>, "move constructor of T must not throw");
+
+    std::optional<T> value;
+    popData([&value](T& data) noexcept { value.emplace(std::move(data)); });
+
+    return value;
+  }
+
+  //Compatibility interface, boxes popped value into new allocation
+  std::unique_ptr<T> pop()
+  {
+    auto value = pop_value();
+
+    return value ? std::make_unique<T>(std::move(*value)) : nullptr;
+  }
+
+  bool is_lock_free() const noexcept
+  {
+    return false;
+  }
+
+  ~Stack()
+  {
+    while (head_)
+    {
+      const auto next = head_->next;
+      head_->destroyValue();
+      destroyNode(head_);
+      head_ = next;
+    }
+  }
+
+ private:
+  template <typename Consumer>
+  bool popData(Consumer&& consume) noexcept
+  {
+    static_assert(std::is_nothrow_destructible_v<T>, "destructor of T must not throw");
+
+    Node* const node = apply(State::pop, nullptr);
+
+    if (!node)
+    {
+      return false;
+    }
+
+    consume(node->value());
+    node->destroyValue();
+
+    destroyNode(node);
+
+    return true;
+  }
+};
+
+}
@@ -1,76 +1,281 @@
 #pragma once
 
+#include <algorithm>
 #include <atomic>
+#include <cstddef>
 #include <memory>
+#include <new>
+#include <optional>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+#include <contention.hpp>
 
 #include <hp.hpp>
 
 namespace lock_free
 {
 
-template <typename T>
+template <typename T, typename Allocator = std::allocator<T>, typename Counting = contention::Mode>
 class Stack
 {
-  struct Node final
+  //Value lives inside of node while node is in the list and is destroyed right after pop.
+  //Retired node is linked into reclaim list by itself, so pop doesn't allocate.
+  struct Node final : hazard_pointers::Reclaimable<Node>
   {
-    std::unique_ptr<T> data;
+    alignas(T) std::byte storage[sizeof(T)];
     Node* next{};
 
-    explicit Node(std::unique_ptr<T> data) : data{std::move(data)} {}
+    template <typename... Args>
+    explicit Node(Args&&... args)
+    {
+      ::new (static_cast<void*>(storage)) T(std::forward<Args>(args)...);
+    }
+
+    T& value() noexcept
+    {
+      return *std::launder(reinterpret_cast<T*>(storage));
+    }
+
+    void destroyValue() noexcept
+    {
+      value().~T();
+    }
   };
 
+  using NodeAllocator = typename std::allocator_traits<Allocator>::template rebind_alloc<Node>;
+  using NodeAllocatorTraits = std::allocator_traits<NodeAllocator>;
+
+  static_assert(NodeAllocatorTraits::is_always_equal::value, "node allocator must be stateless");
+
+  template <typename... Args>
+  static Node* createNode(Args&&... args)
+  {
+    NodeAllocator allocator;
+    Node* const node = NodeAllocatorTraits::allocate(allocator, 1);
+    try
+    {
+      NodeAllocatorTraits::construct(allocator, node, std::forward<Args>(args)...);
+    }
+    catch (...)
+    {
+      NodeAllocatorTraits::deallocate(allocator, node, 1);
+      throw;
+    }
+
+    return node;
+  }
+
+  static void destroyNode(Node* const node) noexcept
+  {
+    NodeAllocator allocator;
+    NodeAllocatorTraits::destroy(allocator, node);
+    NodeAllocatorTraits::deallocate(allocator, node, 1);
+  }
+
+  hazard_pointers::HazardPointerDomain& domain_;
   std::atomic<Node*> head_{};
-  std::atomic<Node*> nodes_to_reclame_{};
 
  public:
+  //First use of default domain allocates its state
+  Stack() : domain_{hazard_pointers::defaultDomain()} {}
+
+  //Stacks with own domain don't scan hazard pointers of each other
+  explicit Stack(hazard_pointers::HazardPointerDomain& domain) noexcept : domain_{domain} {}
+
+  Stack(const Stack&) = delete;
+  Stack& operator=(const Stack&) = delete;
 
   void push(T&& data)
   {
-    pushReadyData(std::make_unique<T>(std::move(data)));
+    pushNode(createNode(std::move(data)));
   }
 
   void push(const T& data)
   {
-    pushReadyData(std::make_unique<T>(data));
+    pushNode(createNode(data));
   }
 
   void pushReadyData(std::unique_ptr<T> data)
   {
-    pushNode(new Node{std::move(data)});
+    if (!data)
+    {
+      throw std::invalid_argument{"null value can't be pushed"};
+    }
+
+    pushNode(createNode(std::move(*data)));
+  }
+
+  //Links nodes privately and publishes them with one CAS, last element ends up on top
+  template <typename InputIt>
+  void pushRange(InputIt first, const InputIt last)
+  {
+    Node* chain_first{};
+    Node* chain_last{};
+
+    try
+    {
+      for (; first != last; ++first)
+      {
+        Node* const node = createNode(*first);
+        node->next = chain_first;
+        chain_first = node;
+        chain_last = chain_last ? chain_last : node;
+      }
+    }
+    catch (...)
+    {
+      for (Node* node = chain_first; node;)
+      {
+        Node* const next = node->next;
+        node->destroyValue();
+        destroyNode(node);
+        node = next;
+      }
+      throw;
+    }
+
+    if (chain_first)
+    {
+      pushChain(chain_first, chain_last);
+    }
+  }
+
+  bool try_pop(T& value) noexcept
+  {
+    static_assert(std::is_nothrow_move_assignable_v<T>, "move assignment of T must not throw");
+
+    return popData([&value](T& data) noexcept { value = std::move(data); });
+  }
+
+  std::optional<T> pop_value() noexcept
+  {
+    static_assert(std::is_nothrow_move_constructible_v<T>, "move constructor of T must not throw");
+
+    std::optional<T> value;
+    popData([&value](T& data) noexcept { value.emplace(std::move(data)); });
+
+    return value;
+  }
+
+  //Compatibility interface, boxes popped value into new allocation
+  std::unique_ptr<T> pop()
+  {
+    auto value = pop_value();
+
+    return value ? std::make_unique<T>(std::move(*value)) : nullptr;
   }
 
-  std::unique_ptr<T> pop() noexcept
+  //Detaches the whole list with one exchange, values are returned in pop order
+  std::vector<T> popAll()
   {
-    std::atomic<void*>& hp = hazard_pointers::getHazardPointerForCurrentThread();
+    static_assert(std::is_nothrow_move_constructible_v<T>, "move constructor of T must not throw");
+
+    Node* const first = head_.exchange(nullptr, std::memory_order_acquire);
 
-    Node* old_head = head_.load();
+    std::size_t count{};
+    Node* last{};
+    for (Node* node = first; node; last = node, node = node->next, ++count);
 
-    do
+    std::vector<T> values;
+    try
     {
-      Node* temp;
-      do 
+      values.reserve(count);
+    }
+    catch (...)
+    {
+      if (first)
       {
-        temp = old_head;
-        hp.exchange(old_head, std::memory_order_relaxed);
-        old_head = head_.load(); 
+        pushChain(first, last);
       }
-      while (temp != old_head);  //It might be ub, but ok for us
-    } 
-    while (old_head && !head_.compare_exchange_strong(old_head, old_head->next,
-                                                      std::memory_order_acquire, 
-                                                      std::memory_order_relaxed));
-    
-    if (!old_head)
+      throw;
+    }
+
+    //Other threads may still hold hazard pointers to detached nodes
+    for (Node* node = first; node;)
     {
-      return {};
+      Node* const next = node->next;
+
+      values.push_back(std::move(node->value()));
+      node->destroyValue();
+      hazard_pointers::addToReclaimList(domain_, node, &destroyNode);
+
+      node = next;
     }
 
-    std::unique_ptr data = std::move(old_head->data);
+    hazard_pointers::reclaimIfPossible(domain_);
+
+    return values;
+  }
+
+  //Walks up to n nodes hand over hand with second hazard pointer and detaches them with one CAS.
+  //Domains with one hazard pointer per thread fall back to popping nodes one by one.
+  std::vector<T> popN(const std::size_t n)
+  {
+    static_assert(std::is_nothrow_move_constructible_v<T>, "move constructor of T must not throw");
 
-    hazard_pointers::addToReclaimList(old_head);
-    hazard_pointers::reclaimIfPossible();
+    std::vector<T> values;
 
-    return data;
+    if (!n)
+    {
+      return values;
+    }
+
+    if (domain_.slotsPerThread() < 2)
+    {
+      //Vector grows before each pop, so popped value always has a place
+      while (values.size() < n)
+      {
+        if (values.size() == values.capacity() && !growValues(values, n))
+        {
+          break;
+        }
+
+        if (!popData([&values](T& data) noexcept { values.push_back(std::move(data)); }))
+        {
+          break;
+        }
+      }
+
+      return values;
+    }
+
+    Node* const first = detachChain(n);
+
+    //n may be much bigger than the stack, so only detached nodes are reserved
+    std::size_t count{};
+    Node* last{};
+    for (Node* node = first; node; last = node, node = node->next, ++count);
+
+    try
+    {
+      values.reserve(count);
+    }
+    catch (...)
+    {
+      if (first)
+      {
+        pushChain(first, last);
+      }
+      throw;
+    }
+
+    //Other threads may still hold hazard pointers to detached nodes
+    for (Node* node = first; node;)
+    {
+      Node* const next = node->next;
+
+      values.push_back(std::move(node->value()));
+      node->destroyValue();
+      hazard_pointers::addToReclaimList(domain_, node, &destroyNode);
+
+      node = next;
+    }
+
+    hazard_pointers::reclaimIfPossible(domain_);
+
+    return values;
   }
 
   bool is_lock_free() const noexcept
@@ -83,7 +288,8 @@ class Stack
     for (auto ptr = head_.load(std::memory_order_acquire); ptr;)
     {
       const auto next = ptr->next;
-      delete ptr;
+      ptr->destroyValue();
+      destroyNode(ptr);
       ptr = next;
     }
   }
@@ -92,11 +298,112 @@ class Stack
 
   void pushNode(Node* const node) noexcept
   {
-    node->next = head_.load(std::memory_order_relaxed);
+    pushChain(node, node);
+  }
+
+  void pushChain(Node* const first, Node* const last) noexcept
+  {
+    last->next = head_.load(std::memory_order_relaxed);
+
+    while (!contention::cas(head_.compare_exchange_weak(last->next, first,
+                                                        std::memory_order_release,
+                                                        std::memory_order_relaxed)));
+  }
+
+  //Doubles capacity up to n. Returns false if values are already popped and vector can't grow,
+  //then caller returns them instead of losing them.
+  static bool growValues(std::vector<T>& values, const std::size_t n)
+  {
+    try
+    {
+      values.reserve(std::min(n, std::max<std::size_t>(2 * values.capacity(), 16)));
+    }
+    catch (...)
+    {
+      if (values.empty())
+      {
+        throw;
+      }
+      return false;
+    }
+
+    return true;
+  }
+
+  //Returns up to n top nodes, last detached node has nullptr as next
+  Node* detachChain(const std::size_t n)
+  {
+    for (;;)
+    {
+      Node* const old_head = hazard_pointers::protect(domain_, 0, head_);
+
+      if (!old_head)
+      {
+        hazard_pointers::clearHazardPointers(domain_);
+        return nullptr;
+      }
+
+      //Protected old_head can't be reused, so while it is on top nodes below it stay in the list
+      Node* last = old_head;
+      std::size_t count{1};
+      bool head_moved{};
+      for (; count < n; ++count)
+      {
+        Node* const next = last->next;
+        if (!next)
+        {
+          break;
+        }
+
+        hazard_pointers::publish(domain_, 1, next);
+        if (head_.load() != old_head)
+        {
+          head_moved = true;
+          break;
+        }
+
+        last = next;
+      }
+
+      Node* expected = old_head;
+      if (!head_moved && contention::cas(head_.compare_exchange_strong(expected, last->next,
+                                                                       std::memory_order_acquire,
+                                                                       std::memory_order_relaxed)))
+      {
+        last->next = nullptr;
+        return old_head;
+      }
+    }
+  }
+
+  template <typename Consumer>
+  bool popData(Consumer&& consume) noexcept
+  {
+    static_assert(std::is_nothrow_destructible_v<T>, "destructor of T must not throw");
+
+    Node* old_head = hazard_pointers::protect(domain_, 0, head_);
+
+    while (old_head && !contention::cas(head_.compare_exchange_strong(old_head, old_head->next,
+                                                                      std::memory_order_acquire,
+                                                                      std::memory_order_relaxed)))
+    {
+      old_head = hazard_pointers::protect(domain_, 0, head_);
+    }
+
+    if (!old_head)
+    {
+      hazard_pointers::clearHazardPointers(domain_);
+      contention::count(contention::Event::empty_pop);
+      return false;
+    }
+
+    consume(old_head->value());
+    old_head->destroyValue();
+
+    hazard_pointers::addToReclaimList(domain_, old_head, &destroyNode);
+    hazard_pointers::reclaimIfPossible(domain_);
 
-    while (!head_.compare_exchange_weak(node->next, node,
-                                        std::memory_order_release,
-                                        std::memory_order_relaxed));
+    return true;
   }
 };
 
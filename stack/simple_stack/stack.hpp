@@ -1,57 +1,204 @@
 #pragma once
 
 #include <atomic>
+#include <cstddef>
+#include <cstdint>
 #include <memory>
+#include <new>
+#include <optional>
+#include <stdexcept>
 #include <type_traits>
+#include <vector>
+
+#include <contention.hpp>
 
 namespace lock_free
 {
 
-template <typename T>
+template <typename T, typename Allocator = std::allocator<T>, typename Counting = contention::Mode>
 class Stack
 {
+  //Value lives inside of node while node is in the list and is destroyed right after pop
   struct Node final
   {
     Node* next{};
-    std::unique_ptr<T> data;
+    alignas(T) std::byte storage[sizeof(T)];
+
+    template <typename... Args>
+    explicit Node(Args&&... args)
+    {
+      ::new (static_cast<void*>(storage)) T(std::forward<Args>(args)...);
+    }
 
-    Node(std::unique_ptr<T> data) : data{std::move(data)} {}
+    T& value() noexcept
+    {
+      return *std::launder(reinterpret_cast<T*>(storage));
+    }
+
+    void destroyValue() noexcept
+    {
+      value().~T();
+    }
   };
 
+  using NodeAllocator = typename std::allocator_traits<Allocator>::template rebind_alloc<Node>;
+  using NodeAllocatorTraits = std::allocator_traits<NodeAllocator>;
+
+  static_assert(NodeAllocatorTraits::is_always_equal::value, "node allocator must be stateless");
+
+  template <typename... Args>
+  static Node* createNode(Args&&... args)
+  {
+    NodeAllocator allocator;
+    Node* const node = NodeAllocatorTraits::allocate(allocator, 1);
+    try
+    {
+      NodeAllocatorTraits::construct(allocator, node, std::forward<Args>(args)...);
+    }
+    catch (...)
+    {
+      NodeAllocatorTraits::deallocate(allocator, node, 1);
+      throw;
+    }
+
+    return node;
+  }
+
+  static void destroyNode(Node* const node) noexcept
+  {
+    NodeAllocator allocator;
+    NodeAllocatorTraits::destroy(allocator, node);
+    NodeAllocatorTraits::deallocate(allocator, node, 1);
+  }
+
  public:
+  //Nodes popped while other threads are in pop wait in nodes_to_delete_ list
+  struct ReclamationStats
+  {
+    std::size_t retired{};
+    std::size_t peak_retired{};
+    //Nodes deleted from the list
+    std::uint64_t reclaimed{};
+  };
+
   Stack() = default;
   Stack(const Stack&) = delete;
   Stack& operator=(const Stack&) = delete;
 
   void push(T data)
   {
-    pushReadyData(std::make_unique<T>(std::move(data)));
+    pushNode(createNode(std::move(data)));
   }
 
   void pushReadyData(std::unique_ptr<T> ready_ptr)
   {
-    pushNode(new Node{std::move(ready_ptr)});
+    if (!ready_ptr)
+    {
+      throw std::invalid_argument{"null value can't be pushed"};
+    }
+
+    pushNode(createNode(std::move(*ready_ptr)));
   }
 
-  std::unique_ptr<T> pop() noexcept
+  //Links nodes privately and publishes them with one CAS, last element ends up on top
+  template <typename InputIt>
+  void pushRange(InputIt first, const InputIt last)
   {
-    threads_in_pop_.fetch_add(1, std::memory_order_relaxed);
+    Node* chain_first{};
+    Node* chain_last{};
 
-    auto old_head = head_.load(std::memory_order_relaxed);
+    try
+    {
+      for (; first != last; ++first)
+      {
+        Node* const node = createNode(*first);
+        node->next = chain_first;
+        chain_first = node;
+        chain_last = chain_last ? chain_last : node;
+      }
+    }
+    catch (...)
+    {
+      destroyValues(chain_first);
+      deleteNodes(chain_first);
+      throw;
+    }
+
+    if (chain_first)
+    {
+      pushChain(chain_first, chain_last);
+    }
+  }
+
+  bool try_pop(T& value) noexcept
+  {
+    static_assert(std::is_nothrow_move_assignable_v<T>, "move assignment of T must not throw");
+
+    return popData([&value](T& data) noexcept { value = std::move(data); });
+  }
+
+  std::optional<T> pop_value() noexcept
+  {
+    static_assert(std::is_nothrow_move_constructible_v<T>, "move constructor of T must not throw");
+
+    std::optional<T> value;
+    popData([&value](T& data) noexcept { value.emplace(std::move(data)); });
+
+    return value;
+  }
 
-    for (; old_head && !head_.compare_exchange_weak(old_head, old_head->next, 
-			                            std::memory_order_acquire, 
-						    std::memory_order_relaxed); );
+  //Compatibility interface, boxes popped value into new allocation
+  std::unique_ptr<T> pop()
+  {
+    auto value = pop_value();
+
+    return value ? std::make_unique<T>(std::move(*value)) : nullptr;
+  }
+
+  //Detaches the whole list with one exchange, values are returned in pop order
+  std::vector<T> popAll()
+  {
+    threads_in_pop_.fetch_add(1);
+
+    Node* const first = head_.exchange(nullptr, std::memory_order_acquire);
+
+    return takeChain(first, nullptr);
+  }
 
-    std::unique_ptr data = old_head ? std::move(old_head->data) : nullptr;
+  //Detaches up to n nodes from the top with one CAS, values are returned in pop order
+  std::vector<T> popN(const std::size_t n)
+  {
+    if (!n)
+    {
+      return {};
+    }
+
+    threads_in_pop_.fetch_add(1);
+
+    //Nodes below head are not deleted while this thread is counted in threads_in_pop_
+    Node* first = head_.load(std::memory_order_relaxed);
+    Node* last{};
+    do
+    {
+      if (!first)
+      {
+        break;
+      }
 
-    tryClearPossible(old_head);
+      last = first;
+      for (std::size_t count = 1; count < n && last->next; ++count, last = last->next);
+    }
+    while (!contention::cas(head_.compare_exchange_weak(first, last->next,
+                                                        std::memory_order_acquire,
+                                                        std::memory_order_relaxed)));
 
-    return data;
+    return takeChain(first, last);
   }
 
   ~Stack()
   {
+    destroyValues(head_);
+
     deleteNodes(head_);
     deleteNodes(nodes_to_delete_);
   }
@@ -61,43 +208,138 @@ class Stack
     return head_.is_lock_free();
   }
 
+  ReclamationStats reclamationStats() const noexcept
+  {
+    ReclamationStats stats;
+    stats.retired = pending_deletions_.load(std::memory_order_relaxed);
+    stats.peak_retired = peak_pending_deletions_.load(std::memory_order_relaxed);
+    stats.reclaimed = deleted_later_.load(std::memory_order_relaxed);
+
+    return stats;
+  }
+
  private:
   void pushNode(Node* const node) noexcept
   {
-    node->next = head_.load(std::memory_order_relaxed);
+    pushChain(node, node);
+  }
+
+  void pushChain(Node* const first, Node* const last) noexcept
+  {
+    last->next = head_.load(std::memory_order_relaxed);
+
+    for (; !contention::cas(head_.compare_exchange_weak(last->next, first,
+                                                        std::memory_order_release,
+                                                        std::memory_order_relaxed)); );
+  }
+
+  //Chain [first, last] has been detached by this thread, last equal to nullptr means
+  //the chain ends with nullptr. Pushes chain back if there is no memory for values.
+  std::vector<T> takeChain(Node* const first, Node* last)
+  {
+    static_assert(std::is_nothrow_move_constructible_v<T>, "move constructor of T must not throw");
+    static_assert(std::is_nothrow_destructible_v<T>, "destructor of T must not throw");
+
+    std::size_t count{};
+    if (first)
+    {
+      const Node* const chain_end = last ? last->next : nullptr;
+      for (last = first, count = 1; last->next != chain_end; last = last->next, ++count);
+    }
+
+    std::vector<T> values;
+    try
+    {
+      values.reserve(count);
+    }
+    catch (...)
+    {
+      if (first)
+      {
+        pushChain(first, last);
+      }
+      tryClearPossible(nullptr, nullptr, 0);
+      throw;
+    }
+
+    for (Node* node = first; values.size() < count; node = node->next)
+    {
+      values.push_back(std::move(node->value()));
+      node->destroyValue();
+    }
+
+    tryClearPossible(first, last, count);
+
+    return values;
+  }
+
+  template <typename Consumer>
+  bool popData(Consumer&& consume) noexcept
+  {
+    static_assert(std::is_nothrow_destructible_v<T>, "destructor of T must not throw");
+
+    threads_in_pop_.fetch_add(1);
+
+    auto old_head = head_.load(std::memory_order_relaxed);
+
+    for (; old_head && !contention::cas(head_.compare_exchange_weak(old_head, old_head->next,
+                                                                    std::memory_order_acquire,
+                                                                    std::memory_order_relaxed)); );
+
+    const bool popped = old_head;
+    if (popped)
+    {
+      consume(old_head->value());
+      old_head->destroyValue();
+    }
+    else
+    {
+      contention::count(contention::Event::empty_pop);
+    }
+
+    tryClearPossible(old_head, old_head, popped);
 
-    for (; !head_.compare_exchange_weak(node->next, node, 
-			                std::memory_order_release, 
-					std::memory_order_relaxed); );
+    return popped;
   }
 
-  void tryClearPossible(Node* old_head) noexcept
+  //Other threads in pop might still read detached nodes, so they are deleted only
+  //when this thread is the only one in pop
+  void tryClearPossible(Node* const first, Node* const last, const std::size_t count) noexcept
   {
-    if (threads_in_pop_.fetch_add(0, std::memory_order_relaxed) == 1)
+    if (threads_in_pop_.load() == 1)
     {
       auto nodes_to_delete = nodes_to_delete_.exchange(nullptr, std::memory_order_acquire);
-      if (nodes_to_delete)
+
+      if (threads_in_pop_.fetch_sub(1) == 1)
       {
-        if (!threads_in_pop_.fetch_add(0, std::memory_order_relaxed))
-        {
-          deleteNodes(nodes_to_delete);
-        }
-        else
+        const std::size_t deleted = deleteNodes(nodes_to_delete);
+        if (deleted)
         {
-          addPoppedNodes(nodes_to_delete);
+          pending_deletions_.fetch_sub(deleted, std::memory_order_relaxed);
+          deleted_later_.fetch_add(deleted, std::memory_order_relaxed);
         }
       }
+      else if (nodes_to_delete)
+      {
+        addPoppedNodes(nodes_to_delete);
+      }
 
-      delete old_head;
+      if (first)
+      {
+        last->next = nullptr;
+        deleteNodes(first);
+      }
     }
     else
     {
-      if (old_head)
+      if (first)
       {
-        addPoppedNode(old_head);
+        //Counted before the range is visible to other threads, so counter doesn't go below zero
+        updatePeak(pending_deletions_.fetch_add(count, std::memory_order_relaxed) + count);
+        addPoppedRange(first, last);
       }
 
-      threads_in_pop_.fetch_sub(1, std::memory_order_relaxed);
+      threads_in_pop_.fetch_sub(1);
     }
   }
 
@@ -110,11 +352,6 @@ class Stack
 						   std::memory_order_relaxed););
   }
 
-  void addPoppedNode(Node* const node) noexcept
-  {
-    addPoppedRange(node, node);
-  }
-
   void addPoppedNodes(Node* const first) noexcept
   {
     Node* last = first;
@@ -123,17 +360,37 @@ class Stack
     addPoppedRange(first, last);
   }
 
-  void deleteNodes(Node* current) noexcept
+  void destroyValues(Node* current) noexcept
   {
-    static_assert(std::is_nothrow_destructible_v<T>, "destructor of T must not throw");
+    for (; current; current = current->next)
+    {
+      current->destroyValue();
+    }
+  }
+
+  //Returns number of deleted nodes
+  std::size_t deleteNodes(Node* current) noexcept
+  {
+    std::size_t count{};
+    for (Node* next; current; next = current->next, destroyNode(current), current = next, ++count);
 
-    for (Node* next; current; next = current->next, delete current, current = next);
+    return count;
+  }
+
+  void updatePeak(const std::size_t pending) noexcept
+  {
+    for (std::size_t peak = peak_pending_deletions_.load(std::memory_order_relaxed);
+         peak < pending && !peak_pending_deletions_.compare_exchange_weak(peak, pending, std::memory_order_relaxed););
   }
 
   std::atomic<Node*> head_{};
   std::atomic<Node*> nodes_to_delete_{};
 
   std::atomic_size_t threads_in_pop_{};
+
+  std::atomic_size_t pending_deletions_{};
+  std::atomic_size_t peak_pending_deletions_{};
+  std::atomic<std::uint64_t> deleted_later_{};
 };
 
 }
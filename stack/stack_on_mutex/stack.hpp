@@ -1,21 +1,72 @@
+#include <cstddef>
 #include <memory>
 #include <mutex>
+#include <new>
+#include <optional>
+#include <stdexcept>
+#include <type_traits>
 
 namespace lock_free
 {
-template <typename T>
+//Lock may be replaced with any BasicLockable, e.g. lock of locks library
+template <typename T, typename Allocator = std::allocator<T>, typename Lock = std::mutex>
 class Stack
 {
+  //Value lives inside of node while node is in the list and is destroyed right after pop
   struct Node final
   {
     Node* next;
-    std::unique_ptr<T> data;
+    alignas(T) std::byte storage[sizeof(T)];
 
-    Node(std::unique_ptr<T> data) : data{std::move(data)} {}
+    template <typename... Args>
+    explicit Node(Args&&... args)
+    {
+      ::new (static_cast<void*>(storage)) T(std::forward<Args>(args)...);
+    }
+
+    T& value() noexcept
+    {
+      return *std::launder(reinterpret_cast<T*>(storage));
+    }
+
+    void destroyValue() noexcept
+    {
+      value().~T();
+    }
   };
 
+  using NodeAllocator = typename std::allocator_traits<Allocator>::template rebind_alloc<Node>;
+  using NodeAllocatorTraits = std::allocator_traits<NodeAllocator>;
+
+  static_assert(NodeAllocatorTraits::is_always_equal::value, "node allocator must be stateless");
+
+  template <typename... Args>
+  static Node* createNode(Args&&... args)
+  {
+    NodeAllocator allocator;
+    Node* const node = NodeAllocatorTraits::allocate(allocator, 1);
+    try
+    {
+      NodeAllocatorTraits::construct(allocator, node, std::forward<Args>(args)...);
+    }
+    catch (...)
+    {
+      NodeAllocatorTraits::deallocate(allocator, node, 1);
+      throw;
+    }
+
+    return node;
+  }
+
+  static void destroyNode(Node* const node) noexcept
+  {
+    NodeAllocator allocator;
+    NodeAllocatorTraits::destroy(allocator, node);
+    NodeAllocatorTraits::deallocate(allocator, node, 1);
+  }
+
   Node* head_{};
-  std::mutex m_;
+  Lock m_;
 
   //Let's think locking does not throw
   void pushNode(Node* const node) noexcept
@@ -29,47 +80,49 @@ class Stack
  public:
   void push(const T& data)
   {
-    pushReadyData(std::make_unique<T>(data));
+    pushNode(createNode(data));
   }
 
   void push(T&& data)
   {
-    pushReadyData(std::make_unique<T>(std::move(data)));
+    pushNode(createNode(std::move(data)));
   }
 
   void pushReadyData(std::unique_ptr<T> data)
   {
-    const auto node = new Node{std::move(data)};
+    if (!data)
+    {
+      throw std::invalid_argument{"null value can't be pushed"};
+    }
+
+    const auto node = createNode(std::move(*data));
 
     pushNode(node);
   }
 
-  std::unique_ptr<T> pop() noexcept
+  bool try_pop(T& value) noexcept
   {
-    const auto old_head = [&]() noexcept -> Node* {
-      std::lock_guard lk{m_};
+    static_assert(std::is_nothrow_move_assignable_v<T>, "move assignment of T must not throw");
 
-      if (!head_)
-      {
-        return nullptr;
-      }
+    return popData([&value](T& data) noexcept { value = std::move(data); });
+  }
 
-      const auto old_head = head_;
-      head_ = head_->next;
-      
-      return old_head;
-    }();
+  std::optional<T> pop_value() noexcept
+  {
+    static_assert(std::is_nothrow_move_constructible_v<T>, "move constructor of T must not throw");
 
-    if (!old_head)
-    {
-      return {};
-    }
+    std::optional<T> value;
+    popData([&value](T& data) noexcept { value.emplace(std::move(data)); });
 
-    auto data = std::move(old_head->data);
+    return value;
+  }
 
-    delete old_head;
+  //Compatibility interface, boxes popped value into new allocation
+  std::unique_ptr<T> pop()
+  {
+    auto value = pop_value();
 
-    return data;
+    return value ? std::make_unique<T>(std::move(*value)) : nullptr;
   }
 
   bool is_lock_free() const noexcept
@@ -82,9 +135,43 @@ class Stack
     while (head_)
     {
       const auto next = head_->next;
-      delete head_;
+      head_->destroyValue();
+      destroyNode(head_);
       head_ = next;
     }
   }
+
+ private:
+  template <typename Consumer>
+  bool popData(Consumer&& consume) noexcept
+  {
+    static_assert(std::is_nothrow_destructible_v<T>, "destructor of T must not throw");
+
+    const auto old_head = [&]() noexcept -> Node* {
+      std::lock_guard lk{m_};
+
+      if (!head_)
+      {
+        return nullptr;
+      }
+
+      const auto old_head = head_;
+      head_ = head_->next;
+      
+      return old_head;
+    }();
+
+    if (!old_head)
+    {
+      return false;
+    }
+
+    consume(old_head->value());
+    old_head->destroyValue();
+
+    destroyNode(old_head);
+
+    return true;
+  }
 };
 }
@@ -1,22 +1,44 @@
 #pragma once
 
 #include <atomic>
+#include <cstddef>
 #include <memory>
+#include <new>
+#include <optional>
+#include <stdexcept>
+#include <type_traits>
 
 namespace lock_free
 {
 
-template <typename T>
+template <typename T, typename Allocator = std::allocator<T>>
 class Stack
 {
+  //Value lives inside of node while node is in the list and is destroyed right after pop
   struct Node final
   {
     std::shared_ptr<Node> next;
-    std::unique_ptr<T> data;
+    alignas(T) std::byte storage[sizeof(T)];
 
-    Node(std::unique_ptr<T> ptr) : data{std::move(ptr)} {}
+    template <typename... Args>
+    explicit Node(Args&&... args)
+    {
+      ::new (static_cast<void*>(storage)) T(std::forward<Args>(args)...);
+    }
+
+    T& value() noexcept
+    {
+      return *std::launder(reinterpret_cast<T*>(storage));
+    }
+
+    void destroyValue() noexcept
+    {
+      value().~T();
+    }
   };
 
+  using NodeAllocator = typename std::allocator_traits<Allocator>::template rebind_alloc<Node>;
+
   std::shared_ptr<Node> head_;
 
   void pushNode(std::shared_ptr<Node> node) noexcept
@@ -31,21 +53,68 @@ class Stack
  public:
   void push(T&& data)
   {
-    pushReadyData(std::make_unique<T>(std::move(data)));
+    pushNode(std::allocate_shared<Node>(NodeAllocator{}, std::move(data)));
   }
 
   void push(const T& data)
   {
-    pushReadyData(std::make_unique<T>(std::move(data)));
+    pushNode(std::allocate_shared<Node>(NodeAllocator{}, data));
+  }
+
+  void pushReadyData(std::unique_ptr<T> ptr)
+  {
+    if (!ptr)
+    {
+      throw std::invalid_argument{"null value can't be pushed"};
+    }
+
+    pushNode(std::allocate_shared<Node>(NodeAllocator{}, std::move(*ptr)));
+  }
+
+  bool try_pop(T& value) noexcept
+  {
+    static_assert(std::is_nothrow_move_assignable_v<T>, "move assignment of T must not throw");
+
+    return popData([&value](T& data) noexcept { value = std::move(data); });
+  }
+
+  std::optional<T> pop_value() noexcept
+  {
+    static_assert(std::is_nothrow_move_constructible_v<T>, "move constructor of T must not throw");
+
+    std::optional<T> value;
+    popData([&value](T& data) noexcept { value.emplace(std::move(data)); });
+
+    return value;
+  }
+
+  //Compatibility interface, boxes popped value into new allocation
+  std::unique_ptr<T> pop()
+  {
+    auto value = pop_value();
+
+    return value ? std::make_unique<T>(std::move(*value)) : nullptr;
+  }
+
+  bool is_lock_free() const noexcept
+  {
+    return std::atomic_is_lock_free(&head_);
   }
 
-  void pushReadyData(std::unique_ptr<T> ptr) noexcept
+  ~Stack()
   {
-    pushNode(std::make_shared<Node>(std::move(ptr)));
+    for (auto node = head_.get(); node; node = node->next.get())
+    {
+      node->destroyValue();
+    }
   }
 
-  std::unique_ptr<T> pop() noexcept
+ private:
+  template <typename Consumer>
+  bool popData(Consumer&& consume) noexcept
   {
+    static_assert(std::is_nothrow_destructible_v<T>, "destructor of T must not throw");
+
     auto old_head = std::atomic_load_explicit(&head_, std::memory_order_relaxed);
 
     while (old_head && !std::atomic_compare_exchange_weak_explicit(&head_, &old_head, old_head->next, 
@@ -54,15 +123,13 @@ class Stack
 
     if (!old_head)
     {
-      return {};
+      return false;
     }
 
-    return std::move(old_head->data);
-  }
+    consume(old_head->value());
+    old_head->destroyValue();
 
-  bool is_lock_free() const noexcept
-  {
-    return std::atomic_is_lock_free(&head_);
+    return true;
   }
 };
 
@@ -0,0 +1,139 @@
+#include <atomic>
+#include <functional>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <numeric>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <stack.hpp>
+
+constexpr int num_of_pushers{2};
+constexpr int num_of_poppers{2};
+constexpr int batch_size{100};
+constexpr int num_of_batches_per_pusher{1000};
+constexpr int num_of_els_per_pusher{batch_size * num_of_batches_per_pusher};
+constexpr int num_of_els{num_of_pushers * num_of_els_per_pusher};
+
+bool checkOrder()
+{
+  lock_free::Stack<int> stack;
+
+  std::vector<int> values(100);
+  std::iota(values.begin(), values.end(), 0);
+  stack.pushRange(values.begin(), values.end());
+
+  const auto top = stack.popN(10);
+  const auto rest = stack.popAll();
+
+  if (top.size() != 10 || rest.size() != 90 || !stack.popAll().empty() || !stack.popN(5).empty())
+  {
+    std::cout << "Bad sizes of popped batches\n";
+    return false;
+  }
+
+  for (int i = 0; i < 10; ++i)
+  {
+    if (top[i] != 99 - i)
+    {
+      std::cout << "Bad order of popN\n";
+      return false;
+    }
+  }
+
+  for (int i = 0; i < 90; ++i)
+  {
+    if (rest[i] != 89 - i)
+    {
+      std::cout << "Bad order of popAll\n";
+      return false;
+    }
+  }
+
+  //Count bigger than the stack must not be reserved
+  stack.pushRange(values.begin(), values.begin() + 3);
+  if (stack.popN(std::numeric_limits<std::size_t>::max()).size() != 3)
+  {
+    std::cout << "Bad size of popN with huge count\n";
+    return false;
+  }
+
+  return true;
+}
+
+void pushMulty(lock_free::Stack<int>& stack, const int first)
+{
+  std::vector<int> batch(batch_size);
+  for (int i = 0; i < num_of_batches_per_pusher; ++i)
+  {
+    std::iota(batch.begin(), batch.end(), first + i * batch_size);
+    stack.pushRange(batch.begin(), batch.end());
+  }
+}
+
+void popMulty(lock_free::Stack<int>& stack, std::atomic<int>& popped, std::atomic<int>* const check)
+{
+  for (bool pop_all{}; popped.load(std::memory_order_relaxed) < num_of_els; pop_all = !pop_all)
+  {
+    const auto values = pop_all ? stack.popAll() : stack.popN(batch_size / 3);
+    if (values.empty())
+    {
+      std::this_thread::yield();
+    }
+
+    popped.fetch_add(static_cast<int>(values.size()), std::memory_order_relaxed);
+    for (const int value : values)
+    {
+      check[value].fetch_add(1, std::memory_order_relaxed);
+    }
+  }
+}
+
+int main(const int argc, const char* const argv[])
+{
+  const bool verbose = argc > 1 && argv[1] == std::string_view{"--verbose"};
+
+  if (!checkOrder())
+  {
+    return 1;
+  }
+
+  lock_free::Stack<int> st;
+
+  std::atomic<int> popped{};
+  const auto check = std::make_unique<std::atomic<int>[]>(num_of_els);
+
+  std::vector<std::thread> threads;
+  for (int i = 0; i < num_of_poppers; ++i)
+  {
+    threads.emplace_back(&popMulty, std::ref(st), std::ref(popped), check.get());
+  }
+  for (int i = 0; i < num_of_pushers; ++i)
+  {
+    threads.emplace_back(&pushMulty, std::ref(st), i * num_of_els_per_pusher);
+  }
+
+  for (auto& t : threads)
+  {
+    t.join();
+  }
+
+  for (int i = 0; i < num_of_els; ++i)
+  {
+    if (check[i].load() != 1)
+    {
+      std::cout << "Bad check for " + std::to_string(i) + ": popped " + 
+                   std::to_string(check[i].load()) + " times\n";
+      return 1;
+    }
+  }
+
+  if (verbose)
+  {
+    std::cout << "All " + std::to_string(num_of_els) + " elements popped exactly once\n";
+  }
+
+  return 0;
+}
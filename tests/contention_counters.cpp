@@ -0,0 +1,103 @@
+#include <iostream>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <contention.hpp>
+#include <stack.hpp>
+
+using IntStack = lock_free::Stack<int>;
+
+static_assert(contention::enabled, "test has to be built with LOCK_FREE_CONTENTION_COUNTERS");
+
+constexpr int num_of_threads{4};
+constexpr int num_of_els{100000};
+constexpr int num_of_extra_pops{5};
+
+contention::Snapshot difference(const contention::Snapshot& after, const contention::Snapshot& before)
+{
+  return contention::Snapshot{after.cas_attempts - before.cas_attempts,
+                              after.cas_failures - before.cas_failures,
+                              after.validation_retries - before.validation_retries,
+                              after.empty_pops - before.empty_pops};
+}
+
+//Without other threads every push and every pop takes one successful CAS
+bool checkSequential()
+{
+  const auto before = contention::snapshot();
+
+  IntStack stack;
+  for (int i = 0; i < num_of_els; ++i)
+  {
+    stack.push(i);
+  }
+  for (int i = 0; i < num_of_els + num_of_extra_pops; ++i)
+  {
+    stack.pop_value();
+  }
+
+  const auto counted = difference(contention::snapshot(), before);
+
+  return counted.empty_pops == num_of_extra_pops &&
+         counted.cas_attempts - counted.cas_failures == 2 * num_of_els;
+}
+
+//Counters of exited threads stay in snapshot
+bool checkConcurrent(const bool verbose)
+{
+  const auto before = contention::snapshot();
+
+  IntStack stack;
+  std::vector<std::thread> threads;
+  for (int t = 0; t < num_of_threads; ++t)
+  {
+    threads.emplace_back([&stack]{
+      for (int i = 0; i < num_of_els; ++i)
+      {
+        stack.push(i);
+        stack.pop_value();
+      }
+    });
+  }
+
+  for (auto& t : threads)
+  {
+    t.join();
+  }
+
+  const auto counted = difference(contention::snapshot(), before);
+
+  if (verbose)
+  {
+    std::cout << "CAS attempts: " + std::to_string(counted.cas_attempts) +
+                 ", failures: " + std::to_string(counted.cas_failures) +
+                 ", validation retries: " + std::to_string(counted.validation_retries) +
+                 ", empty pops: " + std::to_string(counted.empty_pops) + "\n";
+  }
+
+  //Eliminated pairs of push and pop don't touch head, so there may be less successful CAS
+  const std::uint64_t successful = counted.cas_attempts - counted.cas_failures;
+
+  return counted.cas_failures <= counted.cas_attempts && successful <= 2ULL * num_of_threads * num_of_els &&
+         counted.empty_pops <= 1ULL * num_of_threads * num_of_els;
+}
+
+int main(const int argc, const char* const argv[])
+{
+  const bool verbose = argc > 1 && argv[1] == std::string_view{"--verbose"};
+
+  if (!checkSequential())
+  {
+    std::cout << "Bad counters of sequential pushes and pops\n";
+    return 1;
+  }
+
+  if (!checkConcurrent(verbose))
+  {
+    std::cout << "Bad counters of concurrent pushes and pops\n";
+    return 1;
+  }
+
+  return 0;
+}
@@ -0,0 +1,147 @@
+#include <atomic>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <map.hpp>
+
+using IntMap = lock_free::HashMap<int, std::string>;
+
+constexpr int num_of_threads{4};
+constexpr int num_of_keys_per_thread{50000};
+constexpr int num_of_shared_keys{64};
+constexpr int num_of_shared_ops{200000};
+
+bool checkSequential()
+{
+  IntMap map;
+
+  if (!map.insert(1, "one") || map.insert(1, "uno") || *map.find(1) != "one")
+  {
+    std::cout << "Bad insert of existing key\n";
+    return false;
+  }
+
+  if (map.insert_or_assign(1, "uno") || !map.insert_or_assign(2, "two") || *map.find(1) != "uno")
+  {
+    std::cout << "Bad insert_or_assign\n";
+    return false;
+  }
+
+  if (!map.erase(1) || map.erase(1) || map.find(1) || map.contains(1) || !map.contains(2) || map.size() != 1)
+  {
+    std::cout << "Bad erase\n";
+    return false;
+  }
+
+  return map.insert(1, "one again") && *map.find(1) == "one again";
+}
+
+//Keys of each thread are its own, so every step has only one right result
+void ownKeys(IntMap& map, const int first, std::atomic<bool>& ok)
+{
+  for (int key = first; key < first + num_of_keys_per_thread; ++key)
+  {
+    if (!map.insert(key, std::to_string(key)))
+    {
+      ok = false;
+    }
+  }
+
+  for (int key = first; key < first + num_of_keys_per_thread; ++key)
+  {
+    const auto value = map.find(key);
+    if (!value || *value != std::to_string(key) || map.insert_or_assign(key, std::to_string(-key)))
+    {
+      ok = false;
+    }
+  }
+
+  for (int key = first; key < first + num_of_keys_per_thread; key += 2)
+  {
+    const auto value = map.find(key);
+    if (!value || *value != std::to_string(-key) || !map.erase(key) || map.contains(key))
+    {
+      ok = false;
+    }
+  }
+}
+
+//Every value ever stored for shared key is built from the key, so torn or freed value is seen
+void sharedKeys(IntMap& map, const int seed, std::atomic<bool>& ok)
+{
+  unsigned state = seed;
+  for (int i = 0; i < num_of_shared_ops; ++i)
+  {
+    state = state * 1103515245 + 12345;
+    const int key = -1 - static_cast<int>((state >> 16) % num_of_shared_keys);
+
+    switch ((state >> 8) % 4)
+    {
+      case 0:
+        map.insert(key, std::to_string(key));
+        break;
+      case 1:
+        map.insert_or_assign(key, std::to_string(key));
+        break;
+      case 2:
+        map.erase(key);
+        break;
+      default:
+        if (const auto value = map.find(key); value && *value != std::to_string(key))
+        {
+          ok = false;
+        }
+    }
+  }
+}
+
+int main(const int argc, const char* const argv[])
+{
+  const bool verbose = argc > 1 && argv[1] == std::string_view{"--verbose"};
+
+  if (!checkSequential())
+  {
+    return 1;
+  }
+
+  IntMap map;
+  std::atomic<bool> ok{true};
+
+  std::vector<std::thread> threads;
+  for (int i = 0; i < num_of_threads; ++i)
+  {
+    threads.emplace_back(&ownKeys, std::ref(map), i * num_of_keys_per_thread, std::ref(ok));
+    threads.emplace_back(&sharedKeys, std::ref(map), i, std::ref(ok));
+  }
+
+  for (auto& t : threads)
+  {
+    t.join();
+  }
+
+  if (!ok)
+  {
+    std::cout << "Wrong result of concurrent operation\n";
+    return 1;
+  }
+
+  for (int key = 0; key < num_of_threads * num_of_keys_per_thread; ++key)
+  {
+    if (map.contains(key) != (key % 2 == 1))
+    {
+      std::cout << "Bad state of key " + std::to_string(key) + "\n";
+      return 1;
+    }
+  }
+
+  if (verbose)
+  {
+    std::cout << "Map keeps " + std::to_string(map.size()) + " elements\n";
+  }
+
+  return 0;
+}
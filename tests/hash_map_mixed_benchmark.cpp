@@ -0,0 +1,98 @@
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include <map.hpp>
+
+#ifndef READ_PERCENT
+#define READ_PERCENT 90
+#endif
+
+using IntMap = lock_free::HashMap<int, int>;
+
+constexpr unsigned thread_counts[]{2, 4, 8, 16, 32, 64};
+constexpr int default_ops_per_thread{100000};
+constexpr int key_range{1 << 16};
+
+//Writes are split evenly between insert and erase, so the map stays about half full
+double measure(const unsigned num_of_threads, const int ops_per_thread)
+{
+  IntMap map;
+  for (int key = 0; key < key_range; key += 2)
+  {
+    map.insert(key, key);
+  }
+
+  std::atomic<unsigned> ready{};
+  std::atomic<bool> start{};
+
+  std::vector<std::thread> threads;
+  for (unsigned t = 0; t < num_of_threads; ++t)
+  {
+    threads.emplace_back([&map, &ready, &start, ops_per_thread, seed = t + 1]{
+      ready.fetch_add(1, std::memory_order_relaxed);
+      while (!start.load(std::memory_order_acquire))
+      {
+        std::this_thread::yield();
+      }
+
+      unsigned state = seed;
+      for (int i = 0; i < ops_per_thread; ++i)
+      {
+        state = state * 1103515245 + 12345;
+        const int key = static_cast<int>((state >> 8) % key_range);
+        const unsigned op = (state >> 24) % 100;
+
+        if (op < READ_PERCENT)
+        {
+          map.find(key);
+        }
+        else if (op % 2)
+        {
+          map.insert(key, key);
+        }
+        else
+        {
+          map.erase(key);
+        }
+      }
+    });
+  }
+
+  while (ready.load(std::memory_order_relaxed) != num_of_threads)
+  {
+    std::this_thread::yield();
+  }
+
+  const auto begin = std::chrono::steady_clock::now();
+  start.store(true, std::memory_order_release);
+
+  for (auto& t : threads)
+  {
+    t.join();
+  }
+
+  const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - begin;
+
+  return 1.0 * num_of_threads * ops_per_thread / elapsed.count();
+}
+
+int main(const int argc, char* argv[])
+{
+  const int ops_per_thread = argc > 1 ? std::atoi(argv[1]) : default_ops_per_thread;
+
+  const char* name = strrchr(argv[0], '/');
+  name = name ? name + 1 : argv[0];
+
+  for (const unsigned num_of_threads : thread_counts)
+  {
+    std::cout << name << ',' << num_of_threads << ','
+              << static_cast<long long>(measure(num_of_threads, ops_per_thread)) << std::endl;
+  }
+
+  return 0;
+}
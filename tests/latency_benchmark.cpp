@@ -0,0 +1,222 @@
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include <stack.hpp>
+
+using IntContainer = lock_free::Stack<int>;
+
+constexpr int default_ops_per_thread{100000};
+
+//Time stamp counter where it exists, it costs a few nanoseconds instead of a call to clock
+std::uint64_t ticks() noexcept
+{
+#if defined(__x86_64__) || defined(__i386__)
+  return __rdtsc();
+#else
+  return std::chrono::steady_clock::now().time_since_epoch().count();
+#endif
+}
+
+double ticksPerNanosecond()
+{
+  const auto begin = std::chrono::steady_clock::now();
+  const std::uint64_t begin_ticks = ticks();
+  std::this_thread::sleep_for(std::chrono::milliseconds{20});
+  const std::uint64_t end_ticks = ticks();
+  const std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - begin;
+
+  return (end_ticks - begin_ticks) / elapsed.count();
+}
+
+//Log-linear histogram as HdrHistogram: every power of two is split into sub_buckets equal
+//buckets, so relative error is below 1 / sub_buckets for any value
+class Histogram final
+{
+  static constexpr unsigned sub_bucket_bits{5};
+  static constexpr std::uint64_t sub_buckets{1u << sub_bucket_bits};
+  static constexpr std::size_t num_of_buckets{(64 - sub_bucket_bits + 1) * sub_buckets};
+
+  std::array<std::uint64_t, num_of_buckets> counts_{};
+  std::uint64_t total_{};
+  std::uint64_t max_{};
+
+  static std::size_t indexOf(const std::uint64_t value) noexcept
+  {
+    if (value < sub_buckets)
+    {
+      return value;
+    }
+
+    const unsigned shift = 63 - __builtin_clzll(value) - sub_bucket_bits;
+
+    return (shift + 1) * sub_buckets + ((value >> shift) - sub_buckets);
+  }
+
+  //The middle of the bucket
+  static std::uint64_t valueOf(const std::size_t index) noexcept
+  {
+    if (index < sub_buckets)
+    {
+      return index;
+    }
+
+    const unsigned shift = index / sub_buckets - 1;
+    const std::uint64_t lowest = (sub_buckets + index % sub_buckets) << shift;
+
+    return lowest + ((std::uint64_t{1} << shift) >> 1);
+  }
+
+ public:
+  void record(const std::uint64_t value) noexcept
+  {
+    ++counts_[indexOf(value)];
+    ++total_;
+    max_ = std::max(max_, value);
+  }
+
+  void merge(const Histogram& other) noexcept
+  {
+    for (std::size_t i = 0; i < num_of_buckets; ++i)
+    {
+      counts_[i] += other.counts_[i];
+    }
+    total_ += other.total_;
+    max_ = std::max(max_, other.max_);
+  }
+
+  std::uint64_t percentile(const double percent) const noexcept
+  {
+    const auto rank = static_cast<std::uint64_t>(total_ * percent / 100);
+
+    std::uint64_t seen{};
+    for (std::size_t i = 0; i < num_of_buckets; ++i)
+    {
+      seen += counts_[i];
+      if (seen > rank)
+      {
+        return std::min(valueOf(i), max_);
+      }
+    }
+
+    return max_;
+  }
+
+  std::uint64_t max() const noexcept
+  {
+    return max_;
+  }
+};
+
+struct Latencies final
+{
+  Histogram push;
+  Histogram pop;
+};
+
+//Every thread pushes and pops in turn, as in symmetric benchmark, and times every call
+void measure(const unsigned num_of_threads, const int ops_per_thread, Latencies& result)
+{
+  IntContainer container;
+
+  std::vector<Latencies> latencies(num_of_threads);
+  std::atomic<unsigned> ready{};
+  std::atomic<bool> start{};
+
+  std::vector<std::thread> threads;
+  for (unsigned t = 0; t < num_of_threads; ++t)
+  {
+    threads.emplace_back([&container, &ready, &start, &local = latencies[t], ops_per_thread]{
+      ready.fetch_add(1, std::memory_order_relaxed);
+      while (!start.load(std::memory_order_acquire))
+      {
+        std::this_thread::yield();
+      }
+
+      for (int i = 0; i < ops_per_thread; ++i)
+      {
+        const std::uint64_t before_push = ticks();
+        container.push(i);
+        const std::uint64_t after_push = ticks();
+        container.pop_value();
+        const std::uint64_t after_pop = ticks();
+
+        local.push.record(after_push - before_push);
+        local.pop.record(after_pop - after_push);
+      }
+    });
+  }
+
+  while (ready.load(std::memory_order_relaxed) != num_of_threads)
+  {
+    std::this_thread::yield();
+  }
+  start.store(true, std::memory_order_release);
+
+  for (auto& t : threads)
+  {
+    t.join();
+  }
+
+  for (const auto& local : latencies)
+  {
+    result.push.merge(local.push);
+    result.pop.merge(local.pop);
+  }
+}
+
+void print(const char* const name, const char* const operation, const unsigned num_of_threads,
+           const Histogram& histogram, const double ticks_per_ns)
+{
+  const auto ns = [ticks_per_ns](const std::uint64_t value) {
+    return static_cast<long long>(value / ticks_per_ns);
+  };
+
+  std::cout << name << ',' << operation << ',' << num_of_threads << ','
+            << ns(histogram.percentile(50)) << ',' << ns(histogram.percentile(99)) << ','
+            << ns(histogram.percentile(99.9)) << ',' << ns(histogram.max()) << std::endl;
+}
+
+int main(const int argc, char* argv[])
+{
+  const int ops_per_thread = argc > 1 ? std::atoi(argv[1]) : default_ops_per_thread;
+
+  const char* name = strrchr(argv[0], '/');
+  name = name ? name + 1 : argv[0];
+
+  const double ticks_per_ns = ticksPerNanosecond();
+
+  //The last count has twice more threads than cpus, so lock holders get preempted
+  const unsigned hardware_threads = std::max(1u, std::thread::hardware_concurrency());
+  std::vector<unsigned> thread_counts;
+  for (unsigned count = 1; count < hardware_threads; count *= 2)
+  {
+    thread_counts.push_back(count);
+  }
+  thread_counts.push_back(hardware_threads);
+  thread_counts.push_back(2 * hardware_threads);
+
+  for (const unsigned num_of_threads : thread_counts)
+  {
+    //Histograms are big enough not to be placed on stack
+    const auto latencies = std::make_unique<Latencies>();
+    measure(num_of_threads, ops_per_thread, *latencies);
+
+    print(name, "push", num_of_threads, latencies->push, ticks_per_ns);
+    print(name, "pop", num_of_threads, latencies->pop, ticks_per_ns);
+  }
+
+  return 0;
+}
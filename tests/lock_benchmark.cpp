@@ -0,0 +1,121 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <locks.hpp>
+#include <stack.hpp>
+
+constexpr int default_milliseconds{200};
+
+struct Result final
+{
+  double ops_per_second;
+  //Jain's index of operations done by threads: 1 when all threads did the same,
+  //1 / threads when one thread did everything
+  double fairness;
+};
+
+//Every thread pushes and pops in turn for fixed time, so slow threads are seen in fairness
+template <typename Lock>
+Result measure(const unsigned num_of_threads, const std::chrono::milliseconds duration)
+{
+  lock_free::Stack<int, std::allocator<int>, Lock> stack;
+
+  std::vector<long long> ops(num_of_threads);
+  std::atomic<unsigned> ready{};
+  std::atomic<bool> start{};
+  std::atomic<bool> stop{};
+
+  std::vector<std::thread> threads;
+  for (unsigned t = 0; t < num_of_threads; ++t)
+  {
+    threads.emplace_back([&stack, &ready, &start, &stop, &local = ops[t]]{
+      ready.fetch_add(1, std::memory_order_relaxed);
+      while (!start.load(std::memory_order_acquire))
+      {
+        std::this_thread::yield();
+      }
+
+      long long count{};
+      for (int i = 0; !stop.load(std::memory_order_relaxed); ++i)
+      {
+        stack.push(i);
+        stack.pop_value();
+        count += 2;
+      }
+      local = count;
+    });
+  }
+
+  while (ready.load(std::memory_order_relaxed) != num_of_threads)
+  {
+    std::this_thread::yield();
+  }
+
+  const auto begin = std::chrono::steady_clock::now();
+  start.store(true, std::memory_order_release);
+  std::this_thread::sleep_for(duration);
+  stop.store(true, std::memory_order_relaxed);
+
+  for (auto& t : threads)
+  {
+    t.join();
+  }
+
+  const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - begin;
+
+  double sum{};
+  double sum_of_squares{};
+  for (const long long count : ops)
+  {
+    sum += count;
+    sum_of_squares += 1.0 * count * count;
+  }
+
+  return Result{sum / elapsed.count(), sum_of_squares ? sum * sum / (num_of_threads * sum_of_squares) : 1};
+}
+
+template <typename Lock>
+void run(const char* const name, const char* const lock_name, const std::vector<unsigned>& thread_counts,
+         const std::chrono::milliseconds duration)
+{
+  for (const unsigned num_of_threads : thread_counts)
+  {
+    const Result result = measure<Lock>(num_of_threads, duration);
+
+    std::cout << name << ',' << lock_name << ',' << num_of_threads << ','
+              << static_cast<long long>(result.ops_per_second) << ',' << result.fairness << std::endl;
+  }
+}
+
+int main(const int argc, char* argv[])
+{
+  const std::chrono::milliseconds duration{argc > 1 ? std::atoi(argv[1]) : default_milliseconds};
+
+  const char* name = strrchr(argv[0], '/');
+  name = name ? name + 1 : argv[0];
+
+  //The last count has twice more threads than cpus, so lock holders get preempted
+  const unsigned hardware_threads = std::max(1u, std::thread::hardware_concurrency());
+  std::vector<unsigned> thread_counts;
+  for (unsigned count = 1; count < hardware_threads; count *= 2)
+  {
+    thread_counts.push_back(count);
+  }
+  thread_counts.push_back(hardware_threads);
+  thread_counts.push_back(2 * hardware_threads);
+
+  run<std::mutex>(name, "std_mutex", thread_counts, duration);
+  run<locks::TtasLock>(name, "ttas", thread_counts, duration);
+  run<locks::TicketLock>(name, "ticket", thread_counts, duration);
+  run<locks::McsLock>(name, "mcs", thread_counts, duration);
+  run<locks::ClhLock>(name, "clh", thread_counts, duration);
+
+  return 0;
+}
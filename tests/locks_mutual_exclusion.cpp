@@ -0,0 +1,107 @@
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <locks.hpp>
+
+//Lock based stacks lock in noexcept functions
+template <typename Lock>
+constexpr bool nothrow_lockable_v = noexcept(std::declval<Lock&>().lock()) && noexcept(std::declval<Lock&>().unlock());
+
+static_assert(nothrow_lockable_v<locks::TtasLock> && nothrow_lockable_v<locks::TicketLock> &&
+              nothrow_lockable_v<locks::McsLock> && nothrow_lockable_v<locks::ClhLock>,
+              "locks must not throw");
+
+constexpr int num_of_threads{4};
+constexpr int increments_per_thread{20000};
+
+//Plain counter is incremented under the lock, lost increment means two owners at once
+template <typename Lock>
+bool checkMutualExclusion(const char* const name)
+{
+  Lock lock;
+  long long counter{};
+
+  std::vector<std::thread> threads;
+  for (int t = 0; t < num_of_threads; ++t)
+  {
+    threads.emplace_back([&lock, &counter]{
+      for (int i = 0; i < increments_per_thread; ++i)
+      {
+        std::lock_guard lk{lock};
+        ++counter;
+      }
+    });
+  }
+
+  for (auto& t : threads)
+  {
+    t.join();
+  }
+
+  if (counter != 1LL * num_of_threads * increments_per_thread)
+  {
+    std::cout << std::string{name} + " lost increments: " + std::to_string(counter) + "\n";
+    return false;
+  }
+
+  return true;
+}
+
+template <typename Lock>
+bool checkTryLock(const char* const name)
+{
+  Lock lock;
+
+  if (!lock.try_lock())
+  {
+    std::cout << std::string{name} + " is not taken by try_lock while free\n";
+    return false;
+  }
+
+  bool taken_twice{};
+  std::thread{[&lock, &taken_twice]{ taken_twice = lock.try_lock(); }}.join();
+  lock.unlock();
+
+  if (taken_twice)
+  {
+    std::cout << std::string{name} + " is taken by try_lock while locked\n";
+    return false;
+  }
+
+  return true;
+}
+
+//Queue locks take node from cache of thread for every lock held at the same time
+bool checkNestedQueueLocks()
+{
+  locks::McsLock mcs[3];
+  locks::ClhLock clh[3];
+
+  for (int i = 0; i < 1000; ++i)
+  {
+    std::scoped_lock lk{mcs[0], mcs[1], mcs[2]};
+    std::lock_guard lk0{clh[0]};
+    std::lock_guard lk1{clh[1]};
+    std::lock_guard lk2{clh[2]};
+  }
+
+  return checkMutualExclusion<locks::McsLock>("McsLock after nesting");
+}
+
+int main()
+{
+  const bool passed = checkMutualExclusion<locks::TtasLock>("TtasLock") &&
+                      checkMutualExclusion<locks::TicketLock>("TicketLock") &&
+                      checkMutualExclusion<locks::McsLock>("McsLock") &&
+                      checkMutualExclusion<locks::ClhLock>("ClhLock") &&
+                      checkTryLock<locks::TtasLock>("TtasLock") &&
+                      checkTryLock<locks::TicketLock>("TicketLock") &&
+                      checkTryLock<locks::McsLock>("McsLock") &&
+                      checkNestedQueueLocks();
+
+  return passed ? 0 : 1;
+}
@@ -0,0 +1,113 @@
+#include <atomic>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <stack.hpp>
+
+constexpr int num_of_pushers{4};
+constexpr int num_of_poppers{4};
+constexpr int num_of_els_per_pusher{250000};
+constexpr int num_of_els{num_of_pushers * num_of_els_per_pusher};
+
+void pushMulty(lock_free::Stack<int>& stack, const int first)
+{
+  for (int i = first; i < first + num_of_els_per_pusher; ++i)
+  {
+    stack.push(i);
+  }
+}
+
+void popMulty(lock_free::Stack<int>& stack, std::atomic<int>& popped, std::atomic<int>* const check)
+{
+  while (popped.load(std::memory_order_relaxed) < num_of_els)
+  {
+    int value;
+    if (stack.try_pop(value))
+    {
+      popped.fetch_add(1, std::memory_order_relaxed);
+      check[value].fetch_add(1, std::memory_order_relaxed);
+    }
+    else
+    {
+      std::this_thread::yield();
+    }
+  }
+}
+
+//Values are stored in nodes, so null pointer has nothing to store
+bool checkReadyData()
+{
+  lock_free::Stack<int> stack;
+
+  try
+  {
+    stack.pushReadyData(nullptr);
+    std::cout << "Null ready data is pushed\n";
+    return false;
+  }
+  catch (const std::invalid_argument&)
+  {}
+
+  stack.pushReadyData(std::make_unique<int>(42));
+
+  int value{};
+  if (!stack.try_pop(value) || value != 42 || stack.try_pop(value))
+  {
+    std::cout << "Bad value pushed as ready data\n";
+    return false;
+  }
+
+  return true;
+}
+
+int main(const int argc, const char* const argv[])
+{
+  const bool verbose = argc > 1 && argv[1] == std::string_view{"--verbose"};
+
+  if (!checkReadyData())
+  {
+    return 1;
+  }
+
+  lock_free::Stack<int> st;
+
+  std::atomic<int> popped{};
+  const auto check = std::make_unique<std::atomic<int>[]>(num_of_els);
+
+  std::vector<std::thread> threads;
+  for (int i = 0; i < num_of_poppers; ++i)
+  {
+    threads.emplace_back(&popMulty, std::ref(st), std::ref(popped), check.get());
+  }
+  for (int i = 0; i < num_of_pushers; ++i)
+  {
+    threads.emplace_back(&pushMulty, std::ref(st), i * num_of_els_per_pusher);
+  }
+
+  for (auto& t : threads)
+  {
+    t.join();
+  }
+
+  for (int i = 0; i < num_of_els; ++i)
+  {
+    if (check[i].load() != 1)
+    {
+      std::cout << "Bad check for " + std::to_string(i) + ": popped " + 
+                   std::to_string(check[i].load()) + " times\n";
+      return 1;
+    }
+  }
+
+  if (verbose)
+  {
+    std::cout << "All " + std::to_string(num_of_els) + " elements popped exactly once\n";
+  }
+
+  return 0;
+}
@@ -0,0 +1,103 @@
+#include <atomic>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <queue.hpp>
+
+constexpr int num_of_pushers{4};
+constexpr int num_of_poppers{4};
+constexpr int num_of_els_per_pusher{250000};
+constexpr int num_of_els{num_of_pushers * num_of_els_per_pusher};
+
+void pushMulty(lock_free::Queue<int>& queue, const int first)
+{
+  for (int i = first; i < first + num_of_els_per_pusher; ++i)
+  {
+    queue.push(i);
+  }
+}
+
+//Every popper has to see elements of each pusher in the order they were pushed
+void popMulty(lock_free::Queue<int>& queue, std::atomic<int>& popped, std::atomic<int>* const check,
+              std::atomic<bool>& ordered)
+{
+  int last_seen[num_of_pushers];
+  for (auto& last : last_seen)
+  {
+    last = -1;
+  }
+
+  while (popped.load(std::memory_order_relaxed) < num_of_els)
+  {
+    int value;
+    if (queue.try_pop(value))
+    {
+      popped.fetch_add(1, std::memory_order_relaxed);
+      check[value].fetch_add(1, std::memory_order_relaxed);
+
+      int& last = last_seen[value / num_of_els_per_pusher];
+      if (value <= last)
+      {
+        ordered.store(false, std::memory_order_relaxed);
+      }
+      last = value;
+    }
+    else
+    {
+      std::this_thread::yield();
+    }
+  }
+}
+
+int main(const int argc, const char* const argv[])
+{
+  const bool verbose = argc > 1 && argv[1] == std::string_view{"--verbose"};
+
+  lock_free::Queue<int> queue;
+
+  std::atomic<int> popped{};
+  std::atomic<bool> ordered{true};
+  const auto check = std::make_unique<std::atomic<int>[]>(num_of_els);
+
+  std::vector<std::thread> threads;
+  for (int i = 0; i < num_of_poppers; ++i)
+  {
+    threads.emplace_back(&popMulty, std::ref(queue), std::ref(popped), check.get(), std::ref(ordered));
+  }
+  for (int i = 0; i < num_of_pushers; ++i)
+  {
+    threads.emplace_back(&pushMulty, std::ref(queue), i * num_of_els_per_pusher);
+  }
+
+  for (auto& t : threads)
+  {
+    t.join();
+  }
+
+  for (int i = 0; i < num_of_els; ++i)
+  {
+    if (check[i].load() != 1)
+    {
+      std::cout << "Bad check for " + std::to_string(i) + ": popped " +
+                   std::to_string(check[i].load()) + " times\n";
+      return 1;
+    }
+  }
+
+  if (!ordered.load())
+  {
+    std::cout << "Elements of one pusher were popped out of order\n";
+    return 1;
+  }
+
+  if (verbose)
+  {
+    std::cout << "All " + std::to_string(num_of_els) + " elements popped exactly once and in order\n";
+  }
+
+  return 0;
+}
@@ -5,9 +5,17 @@
 
 #include <stack.hpp>
 
+#ifdef USE_NODE_POOL
+#include <pool.hpp>
+
+using IntStack = lock_free::Stack<int, node_pool::PoolAllocator<int>>;
+#else
+using IntStack = lock_free::Stack<int>;
+#endif
+
 constexpr int num_of_els{3000000};
 
-void pushMulty(lock_free::Stack<int>& stack)
+void pushMulty(IntStack& stack)
 {
   std::cout << "Start pushing\n";
   for (int i = 0; i < num_of_els; ++i)
@@ -17,7 +25,7 @@ void pushMulty(lock_free::Stack<int>& stack)
   std::cout << "Finish pushing\n";
 }
 
-void popMulty(lock_free::Stack<int>& stack, const bool verbose)
+void popMulty(IntStack& stack, const bool verbose)
 {
   std::cout << "Start popping\n";
 
@@ -60,7 +68,7 @@ int main(const int argc, const char* const argv[])
   {
     std::cout << "Verbose mode.\n";
   }
-  lock_free::Stack<int> st;
+  IntStack st;
 
   std::thread pop{&popMulty, std::ref(st), verbose};
   std::this_thread::yield();
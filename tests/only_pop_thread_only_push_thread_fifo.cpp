@@ -0,0 +1,76 @@
+#include <functional>
+#include <iostream>
+#include <string_view>
+#include <thread>
+
+#include <queue.hpp>
+
+using IntQueue = lock_free::Queue<int>;
+
+constexpr int num_of_els{3000000};
+
+void pushMulty(IntQueue& queue)
+{
+  std::cout << "Start pushing\n";
+  for (int i = 0; i < num_of_els; ++i)
+  {
+    queue.push(i);
+  }
+  std::cout << "Finish pushing\n";
+}
+
+//With one pusher elements have to come in the order they were pushed
+void popMulty(IntQueue& queue, const bool verbose, bool& ok)
+{
+  std::cout << "Start popping\n";
+
+  for (int i = 0; i < num_of_els;)
+  {
+    int value;
+    if (queue.try_pop(value))
+    {
+      if (value != i)
+      {
+        std::cout << "Bad order: expected " + std::to_string(i) + ", popped " + std::to_string(value) + "\n";
+        return;
+      }
+      ++i;
+    }
+    else
+    {
+      if (verbose)
+      {
+        std::cout << "Sorry " + std::to_string(i) + "\n";
+      }
+    }
+  }
+
+  ok = !queue.pop_value();
+  if (!ok)
+  {
+    std::cout << "Queue is not empty after all elements popped\n";
+    return;
+  }
+
+  std::cout << "Finish popping\n";
+}
+
+int main(const int argc, const char* const argv[])
+{
+  const bool verbose = argc > 1 && argv[1] == std::string_view{"--verbose"};
+
+  if (verbose)
+  {
+    std::cout << "Verbose mode.\n";
+  }
+  IntQueue queue;
+
+  bool ok{};
+  std::thread pop{&popMulty, std::ref(queue), verbose, std::ref(ok)};
+  std::this_thread::yield();
+  pushMulty(queue);
+
+  pop.join();
+
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,107 @@
+#include <algorithm>
+#include <atomic>
+#include <iostream>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <hp.hpp>
+
+constexpr int num_of_waves{64};
+constexpr int threads_per_wave{4};
+constexpr std::size_t retired_per_thread{1000};
+
+std::atomic<std::size_t> reclaimed{};
+
+struct Object final : hazard_pointers::Reclaimable<Object>
+{
+};
+
+void reclaimObject(Object* const object) noexcept
+{
+  delete object;
+  reclaimed.fetch_add(1, std::memory_order_relaxed);
+}
+
+//Short-lived thread retires objects and exits, first object of it is protected by main thread
+void retireAndExit(hazard_pointers::HazardPointerDomain& domain, std::atomic<Object*>& shared)
+{
+  Object* const first = new Object;
+  shared.store(first);
+  while (shared.load() == first)
+  {
+    std::this_thread::yield();
+  }
+  hazard_pointers::addToReclaimList(domain, first, &reclaimObject);
+
+  for (std::size_t i = 1; i < retired_per_thread; ++i)
+  {
+    hazard_pointers::addToReclaimList(domain, new Object, &reclaimObject);
+    hazard_pointers::reclaimIfPossible(domain);
+  }
+}
+
+int main(const int argc, const char* const argv[])
+{
+  const bool verbose = argc > 1 && argv[1] == std::string_view{"--verbose"};
+
+  hazard_pointers::HazardPointerDomain domain;
+  const std::size_t slots = domain.slotsPerThread();
+
+  std::size_t peak{};
+  for (int wave = 0; wave < num_of_waves; ++wave)
+  {
+    std::vector<std::atomic<Object*>> shared(threads_per_wave);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < threads_per_wave; ++t)
+    {
+      threads.emplace_back(retireAndExit, std::ref(domain), std::ref(shared[t]));
+    }
+
+    //Objects protected in previous wave are released, so hand-off of every wave is small
+    hazard_pointers::clearHazardPointers(domain);
+    for (int t = 0; t < threads_per_wave; ++t)
+    {
+      Object* object{};
+      while (!(object = shared[t].load()))
+      {
+        std::this_thread::yield();
+      }
+      hazard_pointers::protect(domain, t % slots, shared[t]);
+      shared[t].store(nullptr);
+    }
+
+    for (auto& t : threads)
+    {
+      t.join();
+    }
+
+    //Exited threads scan their lists, so only protected objects wait for other threads
+    const auto stats = hazard_pointers::reclamationStats(domain);
+    peak = std::max(peak, stats.retired);
+    if (stats.retired > slots)
+    {
+      std::cout << "Backlog of exited threads is not bounded: " + std::to_string(stats.retired) + "\n";
+      return 1;
+    }
+  }
+
+  hazard_pointers::clearHazardPointers(domain);
+  hazard_pointers::scan(domain);
+
+  const auto stats = hazard_pointers::reclamationStats(domain);
+  if (stats.retired || reclaimed.load() != num_of_waves * threads_per_wave * retired_per_thread)
+  {
+    std::cout << "Objects of exited threads are not reclaimed\n";
+    return 1;
+  }
+
+  if (verbose)
+  {
+    std::cout << "Peak backlog after wave: " + std::to_string(peak) +
+                 ", handed off: " + std::to_string(stats.handed_off) +
+                 ", scans: " + std::to_string(stats.scans) + "\n";
+  }
+
+  return 0;
+}
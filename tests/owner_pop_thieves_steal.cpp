@@ -0,0 +1,123 @@
+#include <atomic>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <deque.hpp>
+
+using IntDeque = lock_free::Deque<int>;
+
+constexpr int num_of_thieves{3};
+constexpr int num_of_els{1000000};
+//Owner pops one element after every pop_period pushes
+constexpr int pop_period{4};
+
+bool checkOrder()
+{
+  //Small buffer has to grow several times
+  IntDeque deque{4};
+  for (int i = 0; i < 100; ++i)
+  {
+    deque.push(i);
+  }
+
+  if (deque.size() != 100 || *deque.pop() != 99 || *deque.steal() != 0 || *deque.steal() != 1)
+  {
+    std::cout << "Owner has to take the last element and thief the first one\n";
+    return false;
+  }
+
+  for (int i = 98; i > 1; --i)
+  {
+    if (*deque.pop() != i)
+    {
+      std::cout << "Bad order of pop\n";
+      return false;
+    }
+  }
+
+  return !deque.pop() && !deque.steal() && deque.empty();
+}
+
+void take(std::atomic<int>* const check, std::atomic<int>& taken, const int value)
+{
+  check[value].fetch_add(1, std::memory_order_relaxed);
+  taken.fetch_add(1, std::memory_order_relaxed);
+}
+
+void steal(IntDeque& deque, std::atomic<int>* const check, std::atomic<int>& taken)
+{
+  while (taken.load(std::memory_order_relaxed) < num_of_els)
+  {
+    if (const auto value = deque.steal())
+    {
+      take(check, taken, *value);
+    }
+    else
+    {
+      std::this_thread::yield();
+    }
+  }
+}
+
+int main(const int argc, const char* const argv[])
+{
+  const bool verbose = argc > 1 && argv[1] == std::string_view{"--verbose"};
+
+  if (!checkOrder())
+  {
+    return 1;
+  }
+
+  IntDeque deque{4};
+  std::atomic<int> taken{};
+  const auto check = std::make_unique<std::atomic<int>[]>(num_of_els);
+
+  std::vector<std::thread> thieves;
+  for (int i = 0; i < num_of_thieves; ++i)
+  {
+    thieves.emplace_back(&steal, std::ref(deque), check.get(), std::ref(taken));
+  }
+
+  for (int i = 0; i < num_of_els; ++i)
+  {
+    deque.push(i);
+    if (i % pop_period == 0)
+    {
+      if (const auto value = deque.pop())
+      {
+        take(check.get(), taken, *value);
+      }
+    }
+  }
+
+  while (const auto value = deque.pop())
+  {
+    take(check.get(), taken, *value);
+  }
+
+  for (auto& t : thieves)
+  {
+    t.join();
+  }
+
+  for (int i = 0; i < num_of_els; ++i)
+  {
+    if (check[i].load() != 1)
+    {
+      std::cout << "Bad check for " + std::to_string(i) + ": taken " +
+                   std::to_string(check[i].load()) + " times\n";
+      return 1;
+    }
+  }
+
+  if (verbose)
+  {
+    std::cout << "All " + std::to_string(num_of_els) + " elements taken exactly once\n";
+  }
+
+  return 0;
+}
@@ -0,0 +1,103 @@
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <future>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include <hp.hpp>
+
+constexpr unsigned hazard_pointer_counts[]{1, 8, 32, 96};
+constexpr std::size_t retired_counts[]{64, 256, 1024, 4096, 16384};
+constexpr int default_rounds{20};
+
+std::atomic<std::size_t> reclaimed{};
+
+void reclaimObject(int* const object) noexcept
+{
+  delete object;
+  reclaimed.fetch_add(1, std::memory_order_relaxed);
+}
+
+//Nanoseconds per retired object of one scan with num_of_hazard_pointers published by other threads
+double measure(hazard_pointers::HazardPointerDomain& domain, const std::size_t num_of_retired, const int rounds)
+{
+  std::atomic<void*>& hp = hazard_pointers::getHazardPointerForCurrentThread(domain, 0);
+
+  std::chrono::duration<double, std::nano> elapsed{};
+  for (int round = 0; round < rounds; ++round)
+  {
+    reclaimed.store(0, std::memory_order_relaxed);
+
+    //Object is protected while it is retired, so it stays in the list until scan
+    for (std::size_t i = 0; i < num_of_retired; ++i)
+    {
+      int* const object = new int{};
+      hp.store(object);
+      hazard_pointers::addToReclaimList(domain, object, &reclaimObject);
+    }
+    hp.store(nullptr);
+
+    const auto begin = std::chrono::steady_clock::now();
+    hazard_pointers::scan(domain);
+    elapsed += std::chrono::steady_clock::now() - begin;
+
+    if (reclaimed.load(std::memory_order_relaxed) != num_of_retired)
+    {
+      std::cerr << "Scan reclaimed " << reclaimed.load() << " of " << num_of_retired << " objects\n";
+      std::exit(1);
+    }
+  }
+
+  return elapsed.count() / rounds / num_of_retired;
+}
+
+int main(const int argc, char* argv[])
+{
+  const int rounds = argc > 1 ? std::atoi(argv[1]) : default_rounds;
+
+  const char* name = strrchr(argv[0], '/');
+  name = name ? name + 1 : argv[0];
+
+  for (const unsigned num_of_hazard_pointers : hazard_pointer_counts)
+  {
+    hazard_pointers::HazardPointerDomain domain{};
+
+    //Other threads only keep their hazard pointers published and sleep
+    std::promise<void> stop;
+    const std::shared_future<void> stopped = stop.get_future().share();
+    std::vector<int> protected_objects(num_of_hazard_pointers);
+    std::atomic<unsigned> ready{};
+
+    std::vector<std::thread> threads;
+    for (unsigned t = 0; t < num_of_hazard_pointers; ++t)
+    {
+      threads.emplace_back([&domain, &stopped, &ready, object = &protected_objects[t]]{
+        hazard_pointers::getHazardPointerForCurrentThread(domain, 0).store(object);
+        ready.fetch_add(1);
+        stopped.wait();
+      });
+    }
+
+    while (ready.load() != num_of_hazard_pointers)
+    {
+      std::this_thread::yield();
+    }
+
+    for (const std::size_t num_of_retired : retired_counts)
+    {
+      std::cout << name << ',' << num_of_hazard_pointers << ',' << num_of_retired << ','
+                << measure(domain, num_of_retired, rounds) << std::endl;
+    }
+
+    stop.set_value();
+    for (auto& t : threads)
+    {
+      t.join();
+    }
+  }
+
+  return 0;
+}
@@ -0,0 +1,104 @@
+#include <atomic>
+#include <iostream>
+#include <string_view>
+#include <thread>
+
+#include <hp.hpp>
+
+constexpr std::size_t num_of_retired{1000};
+//Epoch based reclamation needs a few scans, each of them moves epoch at most once
+constexpr int max_scans{10};
+
+std::atomic<std::size_t> reclaimed{};
+
+struct Object final : hazard_pointers::Reclaimable<Object>
+{
+};
+
+void reclaimObject(Object* const object) noexcept
+{
+  delete object;
+  reclaimed.fetch_add(1, std::memory_order_relaxed);
+}
+
+//Every object is protected while it is retired, so it stays in the list until scan
+void retireProtected(hazard_pointers::HazardPointerDomain& domain)
+{
+  for (std::size_t i = 0; i < num_of_retired; ++i)
+  {
+    const std::atomic<Object*> source{new Object};
+    Object* const object = hazard_pointers::protect(domain, 0, source);
+    hazard_pointers::addToReclaimList(domain, object, &reclaimObject);
+  }
+  hazard_pointers::clearHazardPointers(domain);
+}
+
+bool scanUntilEmpty(hazard_pointers::HazardPointerDomain& domain)
+{
+  for (int i = 0; i < max_scans && hazard_pointers::reclamationStats(domain).retired; ++i)
+  {
+    hazard_pointers::scan(domain);
+  }
+
+  return !hazard_pointers::reclamationStats(domain).retired;
+}
+
+int main(const int argc, const char* const argv[])
+{
+  const bool verbose = argc > 1 && argv[1] == std::string_view{"--verbose"};
+
+  hazard_pointers::HazardPointerDomain domain;
+
+  retireProtected(domain);
+
+  auto stats = hazard_pointers::reclamationStats(domain);
+  if (stats.retired != num_of_retired - reclaimed.load() || stats.retired_by_current_thread > stats.retired)
+  {
+    std::cout << "Bad number of retired objects: " + std::to_string(stats.retired) + "\n";
+    return 1;
+  }
+
+  if (!scanUntilEmpty(domain) || reclaimed.load() != num_of_retired)
+  {
+    std::cout << "Scans left retired objects\n";
+    return 1;
+  }
+
+  stats = hazard_pointers::reclamationStats(domain);
+  if (!stats.scans || stats.reclaimed < num_of_retired - stats.peak_retired ||
+      stats.peak_retired > num_of_retired || stats.max_scan_time > stats.scan_time)
+  {
+    std::cout << "Bad counters of scans\n";
+    return 1;
+  }
+
+  //Objects of exited thread stay retired until other threads scan them
+  reclaimed.store(0);
+  std::thread{[&domain]{ retireProtected(domain); }}.join();
+
+  stats = hazard_pointers::reclamationStats(domain);
+  if (stats.retired != num_of_retired - reclaimed.load() || stats.retired_by_current_thread ||
+      (stats.handed_off && stats.handed_off != stats.retired))
+  {
+    std::cout << "Bad counters after exit of thread: retired " + std::to_string(stats.retired) +
+                 ", handed off " + std::to_string(stats.handed_off) + "\n";
+    return 1;
+  }
+
+  if (!scanUntilEmpty(domain) || reclaimed.load() != num_of_retired)
+  {
+    std::cout << "Scans left objects of exited thread\n";
+    return 1;
+  }
+
+  if (verbose)
+  {
+    stats = hazard_pointers::reclamationStats(domain);
+    std::cout << "Scans: " + std::to_string(stats.scans) + ", reclaimed: " + std::to_string(stats.reclaimed) +
+                 ", peak: " + std::to_string(stats.peak_retired) +
+                 ", handed off: " + std::to_string(stats.handed_off) +
+                 ", scan time: " + std::to_string(stats.scan_time.count()) + " ns\n";
+  }
+
+  return 0;
+}
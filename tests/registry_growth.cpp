@@ -0,0 +1,128 @@
+#include <atomic>
+#include <iostream>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <hp.hpp>
+
+//More threads than the first block of records and than the old limit of 128 records
+constexpr std::size_t num_of_threads{300};
+constexpr int num_of_sequential_threads{1000};
+//Epoch based reclamation needs a few scans, each of them moves epoch at most once
+constexpr int max_scans{10};
+
+std::atomic<std::size_t> reclaimed{};
+
+struct Object final : hazard_pointers::Reclaimable<Object>
+{
+};
+
+void reclaimObject(Object* const object) noexcept
+{
+  delete object;
+  reclaimed.fetch_add(1, std::memory_order_relaxed);
+}
+
+//Objects protected by every thread survive scans, so records of all blocks are visible to scan
+bool checkManyThreads(hazard_pointers::HazardPointerDomain& domain)
+{
+  std::vector<std::atomic<Object*>> sources(num_of_threads);
+  std::atomic<std::size_t> protecting{};
+  std::atomic<bool> release{};
+
+  std::vector<std::thread> threads;
+  for (std::size_t t = 0; t < num_of_threads; ++t)
+  {
+    sources[t].store(new Object);
+    threads.emplace_back([&domain, &source = sources[t], &protecting, &release]{
+      hazard_pointers::protect(domain, 0, source);
+      protecting.fetch_add(1);
+
+      while (!release.load())
+      {
+        std::this_thread::yield();
+      }
+      hazard_pointers::clearHazardPointers(domain);
+    });
+  }
+
+  while (protecting.load() != num_of_threads)
+  {
+    std::this_thread::yield();
+  }
+
+  for (auto& source : sources)
+  {
+    hazard_pointers::addToReclaimList(domain, source.exchange(nullptr), &reclaimObject);
+  }
+  for (int i = 0; i < max_scans; ++i)
+  {
+    hazard_pointers::scan(domain);
+  }
+
+  const bool all_protected = !reclaimed.load();
+
+  release.store(true);
+  for (auto& t : threads)
+  {
+    t.join();
+  }
+
+  if (!all_protected)
+  {
+    std::cout << "Objects protected by threads are reclaimed\n";
+    return false;
+  }
+
+  for (int i = 0; i < max_scans && reclaimed.load() != num_of_threads; ++i)
+  {
+    hazard_pointers::scan(domain);
+  }
+
+  return reclaimed.load() == num_of_threads;
+}
+
+int main(const int argc, const char* const argv[])
+{
+  const bool verbose = argc > 1 && argv[1] == std::string_view{"--verbose"};
+
+  hazard_pointers::HazardPointerDomain domain;
+
+  if (!checkManyThreads(domain))
+  {
+    std::cout << "Objects of many threads are not reclaimed\n";
+    return 1;
+  }
+
+  const std::size_t high_water = hazard_pointers::reclamationStats(domain).records_high_water;
+  if (high_water < num_of_threads)
+  {
+    std::cout << "Bad high water mark: " + std::to_string(high_water) + "\n";
+    return 1;
+  }
+
+  //Records of exited threads are reused, so high water mark stays
+  for (int i = 0; i < num_of_sequential_threads; ++i)
+  {
+    std::thread{[&domain]{
+      const std::atomic<Object*> source{};
+      hazard_pointers::protect(domain, 0, source);
+    }}.join();
+  }
+
+  const std::size_t after_reuse = hazard_pointers::reclamationStats(domain).records_high_water;
+  if (after_reuse != high_water)
+  {
+    std::cout << "Records are not reused: high water " + std::to_string(high_water) +
+                 " grew to " + std::to_string(after_reuse) + "\n";
+    return 1;
+  }
+
+  if (verbose)
+  {
+    std::cout << "Records high water: " + std::to_string(after_reuse) + "\n";
+  }
+
+  return 0;
+}
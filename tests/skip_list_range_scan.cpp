@@ -0,0 +1,189 @@
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <iostream>
+#include <numeric>
+#include <random>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <skip_list.hpp>
+
+using IntList = lock_free::SkipList<int, long>;
+
+constexpr int num_of_keys{20000};
+//Keys divisible by stable_step are never erased, other keys belong to writers
+constexpr int stable_step{8};
+constexpr int num_of_writers{4};
+constexpr int num_of_scanners{2};
+constexpr int num_of_rounds{5};
+
+long valueOf(const int key)
+{
+  return key * 10L;
+}
+
+bool checkSequential()
+{
+  IntList list;
+
+  std::vector<int> keys(1000);
+  std::iota(keys.begin(), keys.end(), 0);
+  std::shuffle(keys.begin(), keys.end(), std::mt19937{});
+  for (const int key : keys)
+  {
+    list.insert(key, valueOf(key));
+  }
+
+  if (list.insert(5, 0) || list.size() != keys.size() || *list.find(5) != valueOf(5))
+  {
+    std::cout << "Bad insert of existing key\n";
+    return false;
+  }
+
+  //Full scan takes many batches of iterator
+  int expected{};
+  for (auto it = list.begin(); it != list.end(); ++it, ++expected)
+  {
+    if (it->first != expected || it->second != valueOf(expected))
+    {
+      std::cout << "Bad order of full scan\n";
+      return false;
+    }
+  }
+
+  for (int key = 0; key < 1000; key += 2)
+  {
+    list.erase(key);
+  }
+
+  if (list.erase(100) || list.find(100) || list.contains(100) || !list.contains(101))
+  {
+    std::cout << "Bad erase\n";
+    return false;
+  }
+
+  expected = 101;
+  for (auto it = list.lower_bound(100); it != list.end() && it->first < 200; ++it, expected += 2)
+  {
+    if (it->first != expected)
+    {
+      std::cout << "Bad range scan\n";
+      return false;
+    }
+  }
+
+  return expected == 201 && list.upper_bound(101)->first == 103 && list.upper_bound(999) == list.end();
+}
+
+void writeKeys(IntList& list, const int residue)
+{
+  for (int round = 0; round < num_of_rounds; ++round)
+  {
+    for (int key = residue; key < num_of_keys; key += stable_step)
+    {
+      list.insert(key, valueOf(key));
+    }
+
+    if (round + 1 == num_of_rounds)
+    {
+      break;
+    }
+
+    for (int key = residue; key < num_of_keys; key += stable_step)
+    {
+      list.erase(key);
+    }
+  }
+}
+
+//Every scan has to be sorted and has to meet every stable key
+void scanKeys(IntList& list, const std::atomic<int>& writers_left, std::atomic<bool>& ok)
+{
+  do
+  {
+    int last{-1};
+    int num_of_stable{};
+
+    for (const auto& [key, value] : list)
+    {
+      if (key <= last || value != valueOf(key))
+      {
+        ok = false;
+        return;
+      }
+
+      last = key;
+      num_of_stable += key % stable_step == 0;
+    }
+
+    if (num_of_stable != num_of_keys / stable_step)
+    {
+      ok = false;
+      return;
+    }
+  }
+  while (writers_left.load());
+}
+
+int main(const int argc, const char* const argv[])
+{
+  const bool verbose = argc > 1 && argv[1] == std::string_view{"--verbose"};
+
+  if (!checkSequential())
+  {
+    return 1;
+  }
+
+  IntList list;
+  for (int key = 0; key < num_of_keys; key += stable_step)
+  {
+    list.insert(key, valueOf(key));
+  }
+
+  std::atomic<int> writers_left{num_of_writers};
+  std::atomic<bool> ok{true};
+
+  std::vector<std::thread> threads;
+  for (int i = 0; i < num_of_scanners; ++i)
+  {
+    threads.emplace_back(&scanKeys, std::ref(list), std::cref(writers_left), std::ref(ok));
+  }
+  for (int i = 0; i < num_of_writers; ++i)
+  {
+    threads.emplace_back([&list, &writers_left, i]{
+      writeKeys(list, i + 1);
+      writers_left.fetch_sub(1);
+    });
+  }
+
+  for (auto& t : threads)
+  {
+    t.join();
+  }
+
+  if (!ok)
+  {
+    std::cout << "Scan missed stable key or saw bad element\n";
+    return 1;
+  }
+
+  //Keys of writers stay after the last round, keys of other residues were never inserted
+  for (int key = 0; key < num_of_keys; ++key)
+  {
+    const int residue = key % stable_step;
+    if (list.contains(key) != (residue <= num_of_writers))
+    {
+      std::cout << "Bad state of key " + std::to_string(key) + "\n";
+      return 1;
+    }
+  }
+
+  if (verbose)
+  {
+    std::cout << "List keeps " + std::to_string(list.size()) + " elements\n";
+  }
+
+  return 0;
+}
@@ -0,0 +1,135 @@
+#include <functional>
+#include <iostream>
+#include <numeric>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <queue.hpp>
+
+using IntQueue = lock_free::Queue<int>;
+
+//Small ring, so spans wrap around it many times
+constexpr std::size_t capacity{64};
+constexpr int batch_size{24};
+constexpr int num_of_batches{100000};
+constexpr int num_of_els{batch_size * num_of_batches};
+
+bool checkWrap()
+{
+  IntQueue queue{capacity};
+
+  std::vector<int> values(capacity + 10);
+  std::iota(values.begin(), values.end(), 0);
+
+  //Only capacity elements fit, the rest must be left to the caller
+  if (queue.tryPushRange(values.begin(), values.end()) != values.begin() + capacity)
+  {
+    std::cout << "Bad number of elements pushed into full ring\n";
+    return false;
+  }
+
+  if (queue.readSpan().size != capacity)
+  {
+    std::cout << "Bad span of full ring\n";
+    return false;
+  }
+  queue.releaseSpan(capacity - 5);
+  queue.tryPushRange(values.begin(), values.begin() + 10);
+
+  //Ready elements are split by the end of ring
+  const auto tail = queue.readSpan();
+  if (tail.size != 5 || *tail.begin() != static_cast<int>(capacity) - 5)
+  {
+    std::cout << "Bad span before end of ring\n";
+    return false;
+  }
+  queue.releaseSpan(tail.size);
+
+  const auto head = queue.readSpan();
+  if (head.size != 10 || *head.begin() != 0)
+  {
+    std::cout << "Bad span after end of ring\n";
+    return false;
+  }
+  queue.releaseSpan(head.size);
+
+  return queue.readSpan().empty();
+}
+
+void pushBatches(IntQueue& queue)
+{
+  std::vector<int> batch(batch_size);
+  for (int i = 0; i < num_of_batches; ++i)
+  {
+    std::iota(batch.begin(), batch.end(), i * batch_size);
+
+    for (auto it = batch.begin(); it != batch.end();)
+    {
+      it = queue.tryPushRange(it, batch.end());
+      if (it != batch.end())
+      {
+        std::this_thread::yield();
+      }
+    }
+  }
+}
+
+void readSpans(IntQueue& queue, const bool verbose, bool& ok)
+{
+  std::size_t num_of_spans{};
+
+  for (int expected = 0; expected < num_of_els;)
+  {
+    const auto span = queue.readSpan();
+    if (span.empty())
+    {
+      std::this_thread::yield();
+      continue;
+    }
+
+    for (const int value : span)
+    {
+      if (value != expected++)
+      {
+        std::cout << "Bad order: expected " + std::to_string(expected - 1) + ", read " + std::to_string(value) + "\n";
+        return;
+      }
+    }
+
+    queue.releaseSpan(span.size);
+    ++num_of_spans;
+  }
+
+  ok = !queue.pop_value();
+  if (!ok)
+  {
+    std::cout << "Queue is not empty after all elements read\n";
+    return;
+  }
+
+  if (verbose)
+  {
+    std::cout << "All " + std::to_string(num_of_els) + " elements read in " + std::to_string(num_of_spans) + " spans\n";
+  }
+}
+
+int main(const int argc, const char* const argv[])
+{
+  const bool verbose = argc > 1 && argv[1] == std::string_view{"--verbose"};
+
+  if (!checkWrap())
+  {
+    return 1;
+  }
+
+  IntQueue queue{capacity};
+
+  bool ok{};
+  std::thread reader{&readSpans, std::ref(queue), verbose, std::ref(ok)};
+  pushBatches(queue);
+
+  reader.join();
+
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,80 @@
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#ifdef USE_QUEUE
+#include <queue.hpp>
+
+using IntContainer = lock_free::Queue<int>;
+#else
+#include <stack.hpp>
+
+using IntContainer = lock_free::Stack<int>;
+#endif
+
+constexpr unsigned thread_counts[]{2, 4, 8, 16, 32, 64};
+constexpr int default_ops_per_thread{100000};
+
+//Every thread pushes and pops in turn, so both ends of container are hit symmetrically
+double measure(const unsigned num_of_threads, const int ops_per_thread)
+{
+  IntContainer container;
+
+  std::atomic<unsigned> ready{};
+  std::atomic<bool> start{};
+
+  std::vector<std::thread> threads;
+  for (unsigned t = 0; t < num_of_threads; ++t)
+  {
+    threads.emplace_back([&container, &ready, &start, ops_per_thread]{
+      ready.fetch_add(1, std::memory_order_relaxed);
+      while (!start.load(std::memory_order_acquire))
+      {
+        std::this_thread::yield();
+      }
+
+      for (int i = 0; i < ops_per_thread; ++i)
+      {
+        container.push(i);
+        container.pop_value();
+      }
+    });
+  }
+
+  while (ready.load(std::memory_order_relaxed) != num_of_threads)
+  {
+    std::this_thread::yield();
+  }
+
+  const auto begin = std::chrono::steady_clock::now();
+  start.store(true, std::memory_order_release);
+
+  for (auto& t : threads)
+  {
+    t.join();
+  }
+
+  const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - begin;
+
+  return 2.0 * num_of_threads * ops_per_thread / elapsed.count();
+}
+
+int main(const int argc, char* argv[])
+{
+  const int ops_per_thread = argc > 1 ? std::atoi(argv[1]) : default_ops_per_thread;
+
+  const char* name = strrchr(argv[0], '/');
+  name = name ? name + 1 : argv[0];
+
+  for (const unsigned num_of_threads : thread_counts)
+  {
+    std::cout << name << ',' << num_of_threads << ',' 
+              << static_cast<long long>(measure(num_of_threads, ops_per_thread)) << std::endl;
+  }
+
+  return 0;
+}
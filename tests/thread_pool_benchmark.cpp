@@ -0,0 +1,99 @@
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <numeric>
+#include <vector>
+
+#include <thread_pool.hpp>
+
+using lock_free::TaskGroup;
+using lock_free::ThreadPool;
+
+constexpr std::size_t thread_counts[]{1, 2, 4, 8};
+constexpr int default_fib_n{30};
+//Below the cutoff fib is computed sequentially, so tasks are small but not tiny
+constexpr int fib_cutoff{12};
+constexpr std::size_t reduce_size{1 << 24};
+constexpr std::size_t reduce_grain{1 << 12};
+
+long sequentialFib(const int n)
+{
+  return n < 2 ? n : sequentialFib(n - 1) + sequentialFib(n - 2);
+}
+
+long fib(ThreadPool& pool, const int n)
+{
+  if (n < fib_cutoff)
+  {
+    return sequentialFib(n);
+  }
+
+  long left{};
+  TaskGroup group;
+  pool.submit(group, [&pool, &left, n] { left = fib(pool, n - 1); });
+  const long right = fib(pool, n - 2);
+  pool.wait(group);
+
+  return left + right;
+}
+
+//Every chunk of grain elements is summed by one task
+long reduce(ThreadPool& pool, const std::vector<int>& data)
+{
+  std::vector<long> partial(data.size() / reduce_grain);
+
+  pool.parallel_for(0, partial.size(), 1, [&data, &partial](const std::size_t chunk) {
+    const auto first = data.begin() + chunk * reduce_grain;
+    partial[chunk] = std::accumulate(first, first + reduce_grain, 0L);
+  });
+
+  return std::accumulate(partial.begin(), partial.end(), 0L);
+}
+
+template <typename F>
+long long measure(F&& workload)
+{
+  const auto begin = std::chrono::steady_clock::now();
+  workload();
+  const auto elapsed = std::chrono::steady_clock::now() - begin;
+
+  return std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count();
+}
+
+int main(const int argc, char* argv[])
+{
+  const int fib_n = argc > 1 ? std::atoi(argv[1]) : default_fib_n;
+
+  const char* name = strrchr(argv[0], '/');
+  name = name ? name + 1 : argv[0];
+
+  std::vector<int> data(reduce_size);
+  std::iota(data.begin(), data.end(), 0);
+
+  //Results are checked, so compiler can not throw the work away
+  const long expected_fib = sequentialFib(fib_n);
+  const long expected_sum = std::accumulate(data.begin(), data.end(), 0L);
+
+  for (const std::size_t num_of_threads : thread_counts)
+  {
+    ThreadPool pool{num_of_threads};
+
+    long fib_result{};
+    const auto fib_time = measure([&] { fib_result = fib(pool, fib_n); });
+
+    long sum{};
+    const auto reduce_time = measure([&] { sum = reduce(pool, data); });
+
+    if (fib_result != expected_fib || sum != expected_sum)
+    {
+      std::cout << "Bad result of " << name << std::endl;
+      return 1;
+    }
+
+    std::cout << name << ",fib," << num_of_threads << ',' << fib_time << std::endl;
+    std::cout << name << ",reduce," << num_of_threads << ',' << reduce_time << std::endl;
+  }
+
+  return 0;
+}
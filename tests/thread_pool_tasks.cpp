@@ -0,0 +1,140 @@
+#include <atomic>
+#include <iostream>
+#include <memory>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <thread_pool.hpp>
+
+using lock_free::TaskGroup;
+using lock_free::ThreadPool;
+
+constexpr std::size_t num_of_workers{4};
+constexpr int num_of_submitters{3};
+constexpr int num_of_tasks{100000};
+constexpr std::size_t range_size{1000000};
+
+long fib(ThreadPool& pool, const int n)
+{
+  if (n < 2)
+  {
+    return n;
+  }
+
+  long left{};
+  TaskGroup group;
+  pool.submit(group, [&pool, &left, n] { left = fib(pool, n - 1); });
+  const long right = fib(pool, n - 2);
+  pool.wait(group);
+
+  return left + right;
+}
+
+//Pool has to run every task submitted before destruction
+bool checkDrainOnDestruction()
+{
+  std::atomic<int> done{};
+  {
+    ThreadPool pool{num_of_workers};
+    for (int i = 0; i < num_of_tasks; ++i)
+    {
+      pool.submit([&done] { done.fetch_add(1, std::memory_order_relaxed); });
+    }
+  }
+
+  return done.load() == num_of_tasks;
+}
+
+//External threads submit to the same group concurrently
+bool checkExternalSubmit(ThreadPool& pool)
+{
+  TaskGroup group;
+  std::atomic<long> sum{};
+
+  std::vector<std::thread> submitters;
+  for (int i = 0; i < num_of_submitters; ++i)
+  {
+    submitters.emplace_back([&pool, &group, &sum] {
+      for (int j = 1; j <= num_of_tasks; ++j)
+      {
+        pool.submit(group, [&sum, j] { sum.fetch_add(j, std::memory_order_relaxed); });
+      }
+    });
+  }
+
+  for (auto& t : submitters)
+  {
+    t.join();
+  }
+  pool.wait(group);
+
+  return sum.load() == num_of_submitters * (num_of_tasks * (num_of_tasks + 1L) / 2);
+}
+
+//Every index is visited exactly once, also from nested loops inside of tasks
+bool checkParallelFor(ThreadPool& pool)
+{
+  const auto check = std::make_unique<std::atomic<int>[]>(range_size);
+
+  pool.parallel_for(0, range_size, 1000, [&check](const std::size_t i) {
+    check[i].fetch_add(1, std::memory_order_relaxed);
+  });
+
+  constexpr std::size_t outer{100};
+  pool.parallel_for(0, outer, 1, [&pool, &check](const std::size_t i) {
+    pool.parallel_for(i * (range_size / outer), (i + 1) * (range_size / outer), 100, [&check](const std::size_t j) {
+      check[j].fetch_add(1, std::memory_order_relaxed);
+    });
+  });
+
+  for (std::size_t i = 0; i < range_size; ++i)
+  {
+    if (check[i].load() != 2)
+    {
+      std::cout << "Bad check for " + std::to_string(i) + ": visited " +
+                   std::to_string(check[i].load()) + " times\n";
+      return false;
+    }
+  }
+
+  return true;
+}
+
+int main(const int argc, const char* const argv[])
+{
+  const bool verbose = argc > 1 && argv[1] == std::string_view{"--verbose"};
+
+  if (!checkDrainOnDestruction())
+  {
+    std::cout << "Pool lost tasks on destruction\n";
+    return 1;
+  }
+
+  ThreadPool pool{num_of_workers};
+
+  if (!checkExternalSubmit(pool))
+  {
+    std::cout << "Bad sum of external tasks\n";
+    return 1;
+  }
+
+  if (!checkParallelFor(pool))
+  {
+    return 1;
+  }
+
+  const long result = fib(pool, 24);
+  if (result != 46368)
+  {
+    std::cout << "Bad fib: " + std::to_string(result) + "\n";
+    return 1;
+  }
+
+  if (verbose)
+  {
+    std::cout << "All tasks done on " + std::to_string(pool.size()) + " workers\n";
+  }
+
+  return 0;
+}
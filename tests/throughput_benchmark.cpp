@@ -0,0 +1,234 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#if defined(PIN_THREADS) && defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include <stack.hpp>
+
+using IntContainer = lock_free::Stack<int>;
+
+constexpr int default_ops_per_thread{100000};
+
+enum class Workload
+{
+  push_only,
+  pop_only,
+  mixed,
+  producer_consumer,
+};
+
+const char* workloadName(const Workload workload)
+{
+  switch (workload)
+  {
+    case Workload::push_only:
+      return "push_only";
+    case Workload::pop_only:
+      return "pop_only";
+    case Workload::mixed:
+      return "mixed_50_50";
+    case Workload::producer_consumer:
+      return "producer_consumer";
+  }
+
+  return "";
+}
+
+//1, 2, 4 and so on up to number of hardware threads, which is always measured
+std::vector<unsigned> threadCounts()
+{
+  const unsigned hardware_threads = std::max(1u, std::thread::hardware_concurrency());
+
+  std::vector<unsigned> counts;
+  for (unsigned count = 1; count < hardware_threads; count *= 2)
+  {
+    counts.push_back(count);
+  }
+  counts.push_back(hardware_threads);
+
+  return counts;
+}
+
+//Thread t runs on cpu t, so results don't depend on scheduler placing threads
+void pinToCpu(const unsigned index)
+{
+#if defined(PIN_THREADS) && defined(__linux__)
+  cpu_set_t cpus;
+  CPU_ZERO(&cpus);
+  CPU_SET(index % std::max(1u, std::thread::hardware_concurrency()), &cpus);
+  pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+#else
+  static_cast<void>(index);
+#endif
+}
+
+void runThread(IntContainer& container, const Workload workload, const unsigned index,
+               const unsigned num_of_producers, const long long total_pushes,
+               std::atomic<long long>& popped, const int ops_per_thread)
+{
+  switch (workload)
+  {
+    case Workload::push_only:
+      for (int i = 0; i < ops_per_thread; ++i)
+      {
+        container.push(i);
+      }
+      break;
+
+    case Workload::pop_only:
+      for (int i = 0; i < ops_per_thread; ++i)
+      {
+        container.pop_value();
+      }
+      break;
+
+    case Workload::mixed:
+    {
+      std::uint32_t state = index + 1;
+      for (int i = 0; i < ops_per_thread; ++i)
+      {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+
+        if (state & 1)
+        {
+          container.push(i);
+        }
+        else
+        {
+          container.pop_value();
+        }
+      }
+      break;
+    }
+
+    case Workload::producer_consumer:
+      if (index < num_of_producers)
+      {
+        for (int i = 0; i < ops_per_thread; ++i)
+        {
+          container.push(i);
+        }
+        break;
+      }
+
+      //Consumers share pops of all pushed elements
+      while (popped.load(std::memory_order_relaxed) < total_pushes)
+      {
+        if (container.pop_value())
+        {
+          popped.fetch_add(1, std::memory_order_relaxed);
+        }
+        else
+        {
+          std::this_thread::yield();
+        }
+      }
+      break;
+  }
+}
+
+//Returns operations per second, every push and every pop is one operation
+double measure(const Workload workload, const unsigned num_of_threads, const int ops_per_thread)
+{
+  IntContainer container;
+
+  //Pops of pop_only never fail, pops of mixed start on half-full container
+  const long long prefill = workload == Workload::pop_only ? 1LL * num_of_threads * ops_per_thread
+                          : workload == Workload::mixed ? ops_per_thread
+                          : 0;
+  for (long long i = 0; i < prefill; ++i)
+  {
+    container.push(static_cast<int>(i));
+  }
+
+  const unsigned num_of_producers = (num_of_threads + 1) / 2;
+  const long long total_pushes = 1LL * num_of_producers * ops_per_thread;
+  std::atomic<long long> popped{};
+
+  std::atomic<unsigned> ready{};
+  std::atomic<bool> start{};
+
+  std::vector<std::thread> threads;
+  for (unsigned t = 0; t < num_of_threads; ++t)
+  {
+    threads.emplace_back([&, t]{
+      pinToCpu(t);
+
+      ready.fetch_add(1, std::memory_order_relaxed);
+      while (!start.load(std::memory_order_acquire))
+      {
+        std::this_thread::yield();
+      }
+
+      runThread(container, workload, t, num_of_producers, total_pushes, popped, ops_per_thread);
+    });
+  }
+
+  while (ready.load(std::memory_order_relaxed) != num_of_threads)
+  {
+    std::this_thread::yield();
+  }
+
+  const auto begin = std::chrono::steady_clock::now();
+  start.store(true, std::memory_order_release);
+
+  for (auto& t : threads)
+  {
+    t.join();
+  }
+
+  const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - begin;
+
+  const double ops = workload == Workload::producer_consumer ? 2.0 * total_pushes
+                   : 1.0 * num_of_threads * ops_per_thread;
+
+  return ops / elapsed.count();
+}
+
+void print(const char* const name, const Workload workload, const unsigned num_of_threads, const double ops_per_second)
+{
+#ifdef BENCHMARK_JSON
+  std::cout << "{\"name\":\"" << name << "\",\"workload\":\"" << workloadName(workload)
+            << "\",\"threads\":" << num_of_threads
+            << ",\"ops_per_second\":" << static_cast<long long>(ops_per_second) << '}' << std::endl;
+#else
+  std::cout << name << ',' << workloadName(workload) << ',' << num_of_threads << ','
+            << static_cast<long long>(ops_per_second) << std::endl;
+#endif
+}
+
+int main(const int argc, char* argv[])
+{
+  const int ops_per_thread = argc > 1 ? std::atoi(argv[1]) : default_ops_per_thread;
+
+  const char* name = strrchr(argv[0], '/');
+  name = name ? name + 1 : argv[0];
+
+  for (const auto workload : {Workload::push_only, Workload::pop_only, Workload::mixed, Workload::producer_consumer})
+  {
+    for (const unsigned num_of_threads : threadCounts())
+    {
+      //Producer and consumer need a thread each
+      if (workload == Workload::producer_consumer && num_of_threads < 2)
+      {
+        continue;
+      }
+
+      print(name, workload, num_of_threads, measure(workload, num_of_threads, ops_per_thread));
+    }
+  }
+
+  return 0;
+}
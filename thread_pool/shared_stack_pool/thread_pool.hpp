@@ -0,0 +1,256 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <parking.hpp>
+#include <stack.hpp>
+
+namespace lock_free
+{
+
+class ThreadPool;
+
+//Tasks submitted to the group are joined by ThreadPool::wait
+class TaskGroup final
+{
+  friend class ThreadPool;
+
+  std::atomic<std::size_t> pending_{};
+  //Threads which still touch the group after their task is counted out
+  std::atomic<std::size_t> finishing_{};
+  parking::Parking parking_;
+
+ public:
+  TaskGroup() = default;
+
+  TaskGroup(const TaskGroup&) = delete;
+  TaskGroup& operator=(const TaskGroup&) = delete;
+};
+
+//Baseline for work-stealing pool with the same interface: all tasks go to one stack on mutex
+class ThreadPool final
+{
+  class Task
+  {
+   public:
+    TaskGroup* const group;
+
+    explicit Task(TaskGroup* const group) noexcept : group{group} {}
+    virtual ~Task() = default;
+
+    virtual void run() noexcept = 0;
+  };
+
+  template <typename F>
+  class FunctionTask final : public Task
+  {
+    F function_;
+
+   public:
+    FunctionTask(TaskGroup* const group, F function) : Task{group}, function_{std::move(function)} {}
+
+    //Task must not throw, there is nobody to catch
+    void run() noexcept override
+    {
+      function_();
+    }
+  };
+
+  std::vector<std::thread> workers_;
+  Stack<Task*> tasks_;
+  parking::Parking parking_;
+  std::atomic<bool> stop_{};
+
+ public:
+  explicit ThreadPool(const std::size_t num_of_workers = std::thread::hardware_concurrency())
+  {
+    const std::size_t size = num_of_workers ? num_of_workers : 1;
+
+    workers_.reserve(size);
+    try
+    {
+      for (std::size_t i = 0; i < size; ++i)
+      {
+        workers_.emplace_back(&ThreadPool::work, this);
+      }
+    }
+    catch (...)
+    {
+      stopWorkers();
+      throw;
+    }
+  }
+
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  std::size_t size() const noexcept
+  {
+    return workers_.size();
+  }
+
+  template <typename F>
+  void submit(F&& function)
+  {
+    pushTask(std::make_unique<FunctionTask<std::decay_t<F>>>(nullptr, std::forward<F>(function)));
+  }
+
+  template <typename F>
+  void submit(TaskGroup& group, F&& function)
+  {
+    group.pending_.fetch_add(1, std::memory_order_relaxed);
+    try
+    {
+      pushTask(std::make_unique<FunctionTask<std::decay_t<F>>>(&group, std::forward<F>(function)));
+    }
+    catch (...)
+    {
+      group.pending_.fetch_sub(1, std::memory_order_relaxed);
+      throw;
+    }
+  }
+
+  //Runs other tasks while tasks of the group are not finished
+  void wait(TaskGroup& group) noexcept
+  {
+    while (group.pending_.load(std::memory_order_acquire))
+    {
+      if (const auto task = tasks_.pop_value())
+      {
+        runTask(*task);
+        continue;
+      }
+
+      const auto ticket = group.parking_.prepareWait();
+      if (!group.pending_.load(std::memory_order_acquire))
+      {
+        group.parking_.cancelWait();
+        break;
+      }
+      group.parking_.wait(ticket);
+    }
+
+    //Group may be destroyed right after return
+    while (group.finishing_.load(std::memory_order_acquire))
+    {
+      std::this_thread::yield();
+    }
+  }
+
+  //Calls function(i) for every i in [begin, end), range is split in halves down to grain
+  template <typename F>
+  void parallel_for(const std::size_t begin, const std::size_t end, const std::size_t grain, const F& function)
+  {
+    TaskGroup group;
+    splitRange(group, begin, end, grain ? grain : 1, function);
+    wait(group);
+  }
+
+  //Waits for all submitted tasks
+  ~ThreadPool()
+  {
+    stopWorkers();
+  }
+
+ private:
+  void stopWorkers() noexcept
+  {
+    stop_.store(true);
+    parking_.notifyAll();
+
+    for (auto& worker : workers_)
+    {
+      worker.join();
+    }
+  }
+
+  //Task is owned by the stack only after push succeeded
+  void pushTask(std::unique_ptr<Task> task)
+  {
+    tasks_.push(task.get());
+    task.release();
+    parking_.notifyOne();
+  }
+
+  static void runTask(Task* const task) noexcept
+  {
+    task->run();
+
+    TaskGroup* const group = task->group;
+    delete task;
+
+    if (group)
+    {
+      group->finishing_.fetch_add(1, std::memory_order_relaxed);
+      if (group->pending_.fetch_sub(1, std::memory_order_acq_rel) == 1)
+      {
+        group->parking_.notifyAll();
+      }
+      group->finishing_.fetch_sub(1, std::memory_order_release);
+    }
+  }
+
+  //Worker leaves only when stop is requested and no task is found after that
+  void work() noexcept
+  {
+    for (;;)
+    {
+      if (const auto task = tasks_.pop_value())
+      {
+        runTask(*task);
+        continue;
+      }
+
+      const auto ticket = parking_.prepareWait();
+      if (const auto task = tasks_.pop_value())
+      {
+        parking_.cancelWait();
+        runTask(*task);
+        continue;
+      }
+
+      if (stop_.load())
+      {
+        parking_.cancelWait();
+        break;
+      }
+      parking_.wait(ticket);
+    }
+  }
+
+  template <typename F>
+  void splitRange(TaskGroup& group, const std::size_t begin, std::size_t end, const std::size_t grain,
+                  const F& function)
+  {
+    while (end - begin > grain)
+    {
+      const std::size_t middle = begin + (end - begin) / 2;
+      try
+      {
+        submit(group, [this, &group, middle, end, grain, &function] {
+          splitRange(group, middle, end, grain, function);
+        });
+      }
+      catch (const std::bad_alloc&)
+      {
+        //Split runs inside of noexcept task, so the rest of the range is run here
+        break;
+      }
+      end = middle;
+    }
+
+    for (std::size_t i = begin; i < end; ++i)
+    {
+      function(i);
+    }
+  }
+};
+
+}
@@ -0,0 +1,352 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <deque.hpp>
+#include <parking.hpp>
+#include <queue.hpp>
+
+namespace lock_free
+{
+
+class ThreadPool;
+
+//Tasks submitted to the group are joined by ThreadPool::wait
+class TaskGroup final
+{
+  friend class ThreadPool;
+
+  std::atomic<std::size_t> pending_{};
+  //Threads which still touch the group after their task is counted out
+  std::atomic<std::size_t> finishing_{};
+  parking::Parking parking_;
+
+ public:
+  TaskGroup() = default;
+
+  TaskGroup(const TaskGroup&) = delete;
+  TaskGroup& operator=(const TaskGroup&) = delete;
+};
+
+//Fixed pool of workers. Each worker has its own Chase-Lev deque, tasks submitted from outside
+//go to global queue. Worker takes tasks from its deque, then from global queue, then steals
+//from random victim. Idle workers sleep in parking instead of spinning.
+class ThreadPool final
+{
+  class Task
+  {
+   public:
+    TaskGroup* const group;
+
+    explicit Task(TaskGroup* const group) noexcept : group{group} {}
+    virtual ~Task() = default;
+
+    virtual void run() noexcept = 0;
+  };
+
+  template <typename F>
+  class FunctionTask final : public Task
+  {
+    F function_;
+
+   public:
+    FunctionTask(TaskGroup* const group, F function) : Task{group}, function_{std::move(function)} {}
+
+    //Task must not throw, there is nobody to catch
+    void run() noexcept override
+    {
+      function_();
+    }
+  };
+
+  static constexpr std::size_t cache_line_size{64};
+
+  struct alignas(cache_line_size) Worker final
+  {
+    Deque<Task*> deque;
+    std::thread thread;
+  };
+
+  struct Current final
+  {
+    ThreadPool* pool;
+    std::size_t index;
+    std::uint64_t random_state;
+  };
+
+  inline static thread_local Current current_{};
+
+  std::vector<std::unique_ptr<Worker>> workers_;
+  Queue<Task*> injection_;
+  parking::Parking parking_;
+  std::atomic<bool> stop_{};
+
+ public:
+  explicit ThreadPool(const std::size_t num_of_workers = std::thread::hardware_concurrency())
+  {
+    const std::size_t size = num_of_workers ? num_of_workers : 1;
+
+    workers_.reserve(size);
+    for (std::size_t i = 0; i < size; ++i)
+    {
+      workers_.push_back(std::make_unique<Worker>());
+    }
+
+    try
+    {
+      for (std::size_t i = 0; i < size; ++i)
+      {
+        workers_[i]->thread = std::thread{&ThreadPool::work, this, i};
+      }
+    }
+    catch (...)
+    {
+      stopWorkers();
+      throw;
+    }
+  }
+
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  std::size_t size() const noexcept
+  {
+    return workers_.size();
+  }
+
+  template <typename F>
+  void submit(F&& function)
+  {
+    pushTask(std::make_unique<FunctionTask<std::decay_t<F>>>(nullptr, std::forward<F>(function)));
+  }
+
+  template <typename F>
+  void submit(TaskGroup& group, F&& function)
+  {
+    group.pending_.fetch_add(1, std::memory_order_relaxed);
+    try
+    {
+      pushTask(std::make_unique<FunctionTask<std::decay_t<F>>>(&group, std::forward<F>(function)));
+    }
+    catch (...)
+    {
+      group.pending_.fetch_sub(1, std::memory_order_relaxed);
+      throw;
+    }
+  }
+
+  //Runs other tasks while tasks of the group are not finished
+  void wait(TaskGroup& group) noexcept
+  {
+    while (group.pending_.load(std::memory_order_acquire))
+    {
+      if (Task* const task = findTask())
+      {
+        runTask(task);
+        continue;
+      }
+
+      const auto ticket = group.parking_.prepareWait();
+      if (!group.pending_.load(std::memory_order_acquire))
+      {
+        group.parking_.cancelWait();
+        break;
+      }
+      group.parking_.wait(ticket);
+    }
+
+    //Group may be destroyed right after return
+    while (group.finishing_.load(std::memory_order_acquire))
+    {
+      std::this_thread::yield();
+    }
+  }
+
+  //Calls function(i) for every i in [begin, end). Range is split in halves down to grain,
+  //halves are pushed to deque of current worker, so idle workers steal big parts first.
+  template <typename F>
+  void parallel_for(const std::size_t begin, const std::size_t end, const std::size_t grain, const F& function)
+  {
+    TaskGroup group;
+    splitRange(group, begin, end, grain ? grain : 1, function);
+    wait(group);
+  }
+
+  //Waits for all submitted tasks
+  ~ThreadPool()
+  {
+    stopWorkers();
+  }
+
+ private:
+  void stopWorkers() noexcept
+  {
+    stop_.store(true);
+    parking_.notifyAll();
+
+    for (const auto& worker : workers_)
+    {
+      if (worker->thread.joinable())
+      {
+        worker->thread.join();
+      }
+    }
+  }
+
+  bool isWorker() const noexcept
+  {
+    return current_.pool == this;
+  }
+
+  //Task is owned by the deque or the queue only after push succeeded
+  void pushTask(std::unique_ptr<Task> task)
+  {
+    if (isWorker())
+    {
+      workers_[current_.index]->deque.push(task.get());
+    }
+    else
+    {
+      injection_.push(task.get());
+    }
+    task.release();
+
+    parking_.notifyOne();
+  }
+
+  //xorshift, seeded by index of worker
+  std::size_t randomVictim() noexcept
+  {
+    std::uint64_t& state = current_.random_state;
+    if (!state)
+    {
+      state = reinterpret_cast<std::uintptr_t>(&current_) | 1;
+    }
+
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+
+    return state % workers_.size();
+  }
+
+  Task* findTask() noexcept
+  {
+    if (isWorker())
+    {
+      if (const auto task = workers_[current_.index]->deque.pop())
+      {
+        return *task;
+      }
+    }
+
+    if (const auto task = injection_.pop_value())
+    {
+      return *task;
+    }
+
+    const std::size_t first = randomVictim();
+    for (std::size_t i = 0; i < workers_.size(); ++i)
+    {
+      const std::size_t victim = (first + i) % workers_.size();
+      if (isWorker() && victim == current_.index)
+      {
+        continue;
+      }
+
+      if (const auto task = workers_[victim]->deque.steal())
+      {
+        return *task;
+      }
+    }
+
+    return nullptr;
+  }
+
+  static void runTask(Task* const task) noexcept
+  {
+    task->run();
+
+    TaskGroup* const group = task->group;
+    delete task;
+
+    if (group)
+    {
+      group->finishing_.fetch_add(1, std::memory_order_relaxed);
+      if (group->pending_.fetch_sub(1, std::memory_order_acq_rel) == 1)
+      {
+        group->parking_.notifyAll();
+      }
+      group->finishing_.fetch_sub(1, std::memory_order_release);
+    }
+  }
+
+  //Worker leaves only when stop is requested and no task is found after that
+  void work(const std::size_t index) noexcept
+  {
+    current_ = Current{this, index, index + 1};
+
+    for (;;)
+    {
+      if (Task* const task = findTask())
+      {
+        runTask(task);
+        continue;
+      }
+
+      const auto ticket = parking_.prepareWait();
+      if (Task* const task = findTask())
+      {
+        parking_.cancelWait();
+        runTask(task);
+        continue;
+      }
+
+      if (stop_.load())
+      {
+        parking_.cancelWait();
+        break;
+      }
+      parking_.wait(ticket);
+    }
+
+    current_ = Current{};
+  }
+
+  template <typename F>
+  void splitRange(TaskGroup& group, const std::size_t begin, std::size_t end, const std::size_t grain,
+                  const F& function)
+  {
+    while (end - begin > grain)
+    {
+      const std::size_t middle = begin + (end - begin) / 2;
+      try
+      {
+        submit(group, [this, &group, middle, end, grain, &function] {
+          splitRange(group, middle, end, grain, function);
+        });
+      }
+      catch (const std::bad_alloc&)
+      {
+        //Split runs inside of noexcept task, so the rest of the range is run here
+        break;
+      }
+      end = middle;
+    }
+
+    for (std::size_t i = begin; i < end; ++i)
+    {
+      function(i);
+    }
+  }
+};
+
+}